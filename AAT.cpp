@@ -0,0 +1,3400 @@
+#include "AAT.h"
+
+#include <assert.h>
+#include <string.h>
+#include <math.h>
+#include <random>
+#include <type_traits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define AAT_X86 1
+#else
+#define AAT_X86 0
+#endif
+
+#if AAT_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#define TARGET_SSE41
+#define TARGET_F16C
+#define TARGET_AVX2_F16C
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_F16C __attribute__((target("avx,f16c")))
+#define TARGET_AVX2_F16C __attribute__((target("avx2,f16c")))
+#endif
+#endif
+
+bool g_allowSIMD = true;
+
+const CPUFeatures& GetCPUFeatures()
+{
+    static CPUFeatures features = []()
+    {
+        CPUFeatures ret;
+#if AAT_X86
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        int maxLeaf = info[0];
+
+        __cpuid(info, 1);
+        bool osUsesXSAVE = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        bool osSavesYMM = osUsesXSAVE && avx && (_xgetbv(0) & 6) == 6;
+        ret.sse41 = (info[2] & (1 << 19)) != 0;
+        ret.f16c = osSavesYMM && (info[2] & (1 << 29)) != 0;
+
+        if (maxLeaf >= 7)
+        {
+            __cpuidex(info, 7, 0);
+            ret.avx2 = osSavesYMM && (info[1] & (1 << 5)) != 0;
+        }
+#else
+        __builtin_cpu_init();
+        ret.sse41 = __builtin_cpu_supports("sse4.1") != 0;
+        ret.avx2 = __builtin_cpu_supports("avx2") != 0;
+        ret.f16c = __builtin_cpu_supports("avx") != 0 && __builtin_cpu_supports("f16c") != 0;
+#endif
+#endif
+        return ret;
+    }();
+    return features;
+}
+
+thread_local ThreadPool* ThreadPool::s_currentPool = nullptr;
+thread_local int ThreadPool::s_currentWorker = -1;
+
+int g_numThreads = 0;
+
+ThreadPool& GetThreadPool()
+{
+    // the calling thread also does work in ParallelFor, so leave a core for it
+    static ThreadPool pool(std::max((g_numThreads > 0 ? g_numThreads : int(std::thread::hardware_concurrency())) - 1, 0));
+    return pool;
+}
+
+template <typename T>
+float AverageOfRectangle(T* data, int width, int height, int sx, int sy, int ex, int ey)
+{
+    sx = std::min(std::max(sx, 0), width - 1);
+    ex = std::min(std::max(ex, 0), width - 1);
+    sy = std::min(std::max(sy, 0), height - 1);
+    ey = std::min(std::max(ey, 0), height - 1);
+
+    float sum = 0.0f;
+    for (int iy = sy; iy <= ey; ++iy)
+    {
+        for (int ix = sx; ix <= ex; ++ix)
+        {
+            sum += float(data[iy*width+ix]);
+        }
+    }
+
+    float sampleCount = float(ey - sy + 1)*float(ex - sx + 1);
+
+    return sum / sampleCount;
+}
+
+void BoxBlurReference(const uint8* source, int width, int height, int radius, std::vector<uint8>& result)
+{
+    std::vector<uint8> resultPing;
+    resultPing.resize(width * height);
+    result.resize(width * height);
+
+    // horizontal blur from source to ping
+    for (int iy = 0; iy < height; ++iy)
+    {
+        for (int ix = 0; ix < width; ++ix)
+        {
+            float average = AverageOfRectangle(source, width, height, ix - radius, iy, ix + radius, iy);
+            resultPing[iy*width + ix] = uint8(0.5f + average);
+        }
+    }
+
+    // vertical blur from ping to pong
+    for (int iy = 0; iy < height; ++iy)
+    {
+        for (int ix = 0; ix < width; ++ix)
+        {
+            float average = AverageOfRectangle(&resultPing[0], width, height, ix, iy - radius, ix, iy + radius);
+            result[iy*width + ix] = uint8(0.5f + average);
+        }
+    }
+}
+
+void BoxBlurSlidingWindow(const uint8* source, int width, int height, int radius, std::vector<uint8>& result)
+{
+    // Same clamping as AverageOfRectangle: the window shrinks at the edges rather than repeating edge pixels.
+    // Sums are integers below 2^24 so float(sum) / float(count) matches the reference float accumulation exactly.
+    std::vector<uint8> resultPing;
+    resultPing.resize(width * height);
+    result.resize(width * height);
+
+    // horizontal blur from source to ping
+    for (int iy = 0; iy < height; ++iy)
+    {
+        const uint8* row = &source[iy*width];
+
+        uint32 sum = 0;
+        for (int ix = 0; ix <= std::min(radius, width - 1); ++ix)
+            sum += row[ix];
+
+        for (int ix = 0; ix < width; ++ix)
+        {
+            int sx = std::max(ix - radius, 0);
+            int ex = std::min(ix + radius, width - 1);
+
+            resultPing[iy*width + ix] = uint8(0.5f + float(sum) / float(ex - sx + 1));
+
+            if (ix + radius + 1 < width)
+                sum += row[ix + radius + 1];
+            if (ix - radius >= 0)
+                sum -= row[ix - radius];
+        }
+    }
+
+    // vertical blur from ping to pong. A whole row of column sums is slid down at once to keep memory access linear.
+    std::vector<uint32> sums;
+    sums.resize(width, 0);
+    for (int iy = 0; iy <= std::min(radius, height - 1); ++iy)
+    {
+        for (int ix = 0; ix < width; ++ix)
+            sums[ix] += resultPing[iy*width + ix];
+    }
+
+    for (int iy = 0; iy < height; ++iy)
+    {
+        int sy = std::max(iy - radius, 0);
+        int ey = std::min(iy + radius, height - 1);
+        float count = float(ey - sy + 1);
+
+        for (int ix = 0; ix < width; ++ix)
+            result[iy*width + ix] = uint8(0.5f + float(sums[ix]) / count);
+
+        if (iy + radius + 1 < height)
+        {
+            const uint8* addRow = &resultPing[(iy + radius + 1)*width];
+            for (int ix = 0; ix < width; ++ix)
+                sums[ix] += addRow[ix];
+        }
+        if (iy - radius >= 0)
+        {
+            const uint8* removeRow = &resultPing[(iy - radius)*width];
+            for (int ix = 0; ix < width; ++ix)
+                sums[ix] -= removeRow[ix];
+        }
+    }
+}
+
+int BlurTileWidthForCache(int radius, int cacheBytes, int bytesPerEntry)
+{
+    int rowsInFlight = radius * 2 + 2;
+    int tileWidth = cacheBytes / (bytesPerEntry * rowsInFlight) - (radius * 2 + 1);
+    return std::max(tileWidth & ~7, 64);
+}
+
+// Drives the table blurs. Only pixels within a box's reach of the edge need their corners clamped to the table, so
+// those go through border(ix, iy) one at a time, and each row's interior span goes through interior(ix, iy, count)
+// which has no clamping or branches. interior returns how many pixels it did, and border picks up any it left over.
+// This does the output pixels in [x0, x1) x [y0, y1).
+template <typename BORDER, typename INTERIOR>
+void ForEachBlurPixelInRect(int width, int height, const BlurBox& box, bool clampEveryPixel, int x0, int y0, int x1, int y1, const BORDER& border, const INTERIOR& interior)
+{
+    int interiorStartX = std::max(box.radiusX - box.offsetX + 1, x0);
+    int interiorEndX = std::min(width - 1 - box.radiusX - box.offsetX, x1 - 1);
+    int interiorStartY = box.radiusY - box.offsetY + 1;
+    int interiorEndY = height - 1 - box.radiusY - box.offsetY;
+
+    for (int iy = y0; iy < y1; ++iy)
+    {
+        int ix = x0;
+        if (!clampEveryPixel && iy >= interiorStartY && iy <= interiorEndY && interiorStartX <= interiorEndX)
+        {
+            for (; ix < interiorStartX; ++ix)
+                border(ix, iy);
+
+            ix += interior(ix, iy, interiorEndX - ix + 1);
+        }
+
+        for (; ix < x1; ++ix)
+            border(ix, iy);
+    }
+}
+
+template <typename BORDER, typename INTERIOR>
+void ForEachBlurPixelInRect(int width, int height, int radius, bool clampEveryPixel, int x0, int y0, int x1, int y1, const BORDER& border, const INTERIOR& interior)
+{
+    ForEachBlurPixelInRect(width, height, BlurBox{ radius, radius }, clampEveryPixel, x0, y0, x1, y1, border, interior);
+}
+
+template <typename BORDER, typename INTERIOR>
+void ForEachBlurPixel(int width, int height, const BlurBox& box, const BlurOptions& options, const BORDER& border, const INTERIOR& interior)
+{
+    int tileWidth = options.tileWidth > 0 ? options.tileWidth : width;
+    int tileHeight = options.tileHeight > 0 ? options.tileHeight : height;
+
+    for (int y0 = 0; y0 < height; y0 += tileHeight)
+    {
+        for (int x0 = 0; x0 < width; x0 += tileWidth)
+            ForEachBlurPixelInRect(width, height, box, options.clampEveryPixel, x0, y0, std::min(x0 + tileWidth, width), std::min(y0 + tileHeight, height), border, interior);
+    }
+}
+
+template <typename BORDER, typename INTERIOR>
+void ForEachBlurPixel(int width, int height, int radius, const BlurOptions& options, const BORDER& border, const INTERIOR& interior)
+{
+    ForEachBlurPixel(width, height, BlurBox{ radius, radius }, options, border, interior);
+}
+
+// Drives the multi radius blurs. This only orders the work: it runs the single radius kernels for every radius of an
+// output row before moving down, and shares no loads between them. Output row iy of a radius reads table rows
+// iy - radius - 1 and iy + radius, which are different rows for each radius, so each radius loads its own two rows.
+// The ordering keeps the table rows from iy - maxRadius - 1 to iy + maxRadius recently used, so when they fit in the
+// last level cache, later radiuses read them from cache instead of memory. When the table is already in cache, or the
+// blur is compute bound, this is no faster than a blur per radius. Column tiles small enough for L2 cost more in short
+// spans than they save, so the default is untiled, like ForEachBlurPixel. The radius index is passed to
+// border(index, ix, iy) and interior(index, ix, iy, count).
+template <typename BORDER, typename INTERIOR>
+void ForEachBlurPixelMultiRadius(int width, int height, const int* radiuses, int numRadiuses, const BlurOptions& options, const BORDER& border, const INTERIOR& interior)
+{
+    int tileWidth = options.tileWidth > 0 ? options.tileWidth : width;
+
+    for (int x0 = 0; x0 < width; x0 += tileWidth)
+    {
+        int x1 = std::min(x0 + tileWidth, width);
+        for (int iy = 0; iy < height; ++iy)
+        {
+            for (int index = 0; index < numRadiuses; ++index)
+            {
+                ForEachBlurPixelInRect(width, height, radiuses[index], options.clampEveryPixel, x0, iy, x1, iy + 1,
+                    [&](int ix, int iy) { border(index, ix, iy); },
+                    [&](int ix, int iy, int count) { return interior(index, ix, iy, count); }
+                );
+            }
+        }
+    }
+}
+
+// The blurs multiply by 1/area in double instead of dividing. x + 0.5 only truncates differently than the divide when
+// x is exactly half way between integers, so a tiny nudge (far smaller than 1/area) makes the reciprocal land on the
+// same side as the exact divide.
+static const double c_reciprocalRoundingNudge = 1.0 / double(1ull << 40);
+
+// The table indices before and at the end of a box along one axis. Boxes are clamped to the image, and a box offset
+// entirely off the image is clamped to the edge pixel it is nearest, so every box covers at least one pixel.
+inline void BoxAxisRange(int i, int offset, int radius, int size, int& start, int& end)
+{
+    start = std::min(std::max(i + offset - radius - 1, -1), size - 2);
+    end = std::min(std::max(i + offset + radius, 0), size - 1);
+}
+
+// Reciprocals of the box size along each axis for a blur of one radius. Boxes are diameter wide inside the border and
+// narrower where they are clamped at the edges, so a pixel's 1 / area is x[ix] * y[iy], and interior pixels all use
+// interior.
+// * x and y are doubles. Their product is within a couple of ulps of 1 / area, which the rounding nudge covers.
+// * fixedX and fixedY are 2^31 / size rounded down, for the integer blurs. (fixedX * fixedY) >> 30 is 2^32 / area or
+//   a little less, so a quotient made with it is exact or a little low, and is corrected from the remainder.
+struct BoxAreaReciprocals
+{
+    BoxAreaReciprocals(int width, int height, int radius)
+        : BoxAreaReciprocals(width, height, BlurBox{ radius, radius })
+    {
+    }
+
+    BoxAreaReciprocals(int width, int height, const BlurBox& box)
+    {
+        interior = 1.0 / double((box.radiusX * 2 + 1) * (box.radiusY * 2 + 1));
+        MakeAxis(width, box.radiusX, box.offsetX, x, fixedX);
+        MakeAxis(height, box.radiusY, box.offsetY, y, fixedY);
+    }
+
+    static void MakeAxis(int size, int radius, int offset, std::vector<double>& reciprocals, std::vector<uint32>& fixedReciprocals)
+    {
+        reciprocals.resize(size);
+        fixedReciprocals.resize(size);
+        for (int i = 0; i < size; ++i)
+        {
+            int start, end;
+            BoxAxisRange(i, offset, radius, size, start, end);
+            int boxSize = end - start;
+            reciprocals[i] = 1.0 / double(boxSize);
+            fixedReciprocals[i] = uint32((uint64_t(1) << 31) / uint64_t(boxSize));
+        }
+    }
+
+    double Area(int ix, int iy) const { return x[ix] * y[iy]; }
+    uint64_t FixedArea(int ix, int iy) const { return (uint64_t(fixedX[ix]) * uint64_t(fixedY[iy])) >> 30; }
+
+    double interior;
+    std::vector<double> x, y;
+    std::vector<uint32> fixedX, fixedY;
+};
+
+inline uint8 SATBoxBlurBiasedPixel(const int32* SAT, int width, int height, const BlurBox& box, int ix, int iy, int bias, double reciprocalArea)
+{
+	int startX, startY, endX, endY;
+	BoxAxisRange(ix, box.offsetX, box.radiusX, width, startX, endX);
+	BoxAxisRange(iy, box.offsetY, box.radiusY, height, startY, endY);
+
+	int32 A = (startX >= 0 && startY >= 0) ? SAT[startY*width + startX] : bias;
+	int32 B = (startY >= 0) ? SAT[startY*width + endX] : -bias;
+	int32 C = (startX >= 0) ? SAT[endY*width + startX] : -bias;
+	int32 D = SAT[endY*width + endX];
+
+	int32 integratedValue = (A + D - B - C);
+
+	return uint8(double(bias) + 0.5 + c_reciprocalRoundingNudge + double(integratedValue) * reciprocalArea);
+}
+
+inline uint8 SATBoxBlurBiasedPixel(const int32* SAT, int width, int height, int radius, int ix, int iy, int bias, double reciprocalArea)
+{
+	return SATBoxBlurBiasedPixel(SAT, width, height, BlurBox{ radius, radius }, ix, iy, bias, reciprocalArea);
+}
+
+// A and C point at the top left and bottom left corners of the first pixel. The right corners are diameter entries further along.
+int SATBoxBlurBiasedInterior(const int32* A, const int32* C, int diameter, int count, int bias, double reciprocalArea, uint8* result)
+{
+	double offset = double(bias) + 0.5 + c_reciprocalRoundingNudge;
+	for (int index = 0; index < count; ++index)
+	{
+		int32 integratedValue = (A[index] + C[index + diameter] - A[index + diameter] - C[index]);
+		result[index] = uint8(offset + double(integratedValue) * reciprocalArea);
+	}
+	return count;
+}
+
+void SATBoxBlurBiasedImage(const int32* SAT, int width, int height, const BlurBox& box, int bias, std::vector<uint8>& result, const BlurOptions& options)
+{
+	result.resize(width * height);
+
+	int boxWidth = box.radiusX * 2 + 1;
+	int left = box.offsetX - box.radiusX - 1;
+	int top = box.offsetY - box.radiusY - 1;
+	int bottom = box.offsetY + box.radiusY;
+
+	BoxAreaReciprocals areas(width, height, box);
+
+	ForEachBlurPixel(width, height, box, options,
+		[&](int ix, int iy)
+		{
+			result[iy*width + ix] = SATBoxBlurBiasedPixel(SAT, width, height, box, ix, iy, bias, areas.Area(ix, iy));
+		},
+		[&](int ix, int iy, int count)
+		{
+			const int32* A = &SAT[(iy + top)*width + ix + left];
+			const int32* C = &SAT[(iy + bottom)*width + ix + left];
+			return SATBoxBlurBiasedInterior(A, C, boxWidth, count, bias, areas.interior, &result[iy*width + ix]);
+		}
+	);
+}
+
+void SATBoxBlurBiasedImage(const int32* SAT, int width, int height, int radius, int bias, std::vector<uint8>& result, const BlurOptions& options)
+{
+	SATBoxBlurBiasedImage(SAT, width, height, BlurBox{ radius, radius }, bias, result, options);
+}
+
+void SATBoxBlurBiasedImage(const std::vector<int32>& SAT, int width, int height, int radius, int bias, std::vector<uint8>& result, const BlurOptions& options)
+{
+	SATBoxBlurBiasedImage(&SAT[0], width, height, radius, bias, result, options);
+}
+
+void SATBoxBlurBiasedImage(const std::vector<int32>& SAT, int width, int height, const BlurBox& box, int bias, std::vector<uint8>& result, const BlurOptions& options)
+{
+	SATBoxBlurBiasedImage(&SAT[0], width, height, box, bias, result, options);
+}
+
+template <typename T>
+inline uint8 SATBoxBlurPixel(const T* SAT, int width, int height, const BlurBox& box, int ix, int iy, int scale, uint32 maxValue, double reciprocalArea)
+{
+	int startX, startY, endX, endY;
+	BoxAxisRange(ix, box.offsetX, box.radiusX, width, startX, endX);
+	BoxAxisRange(iy, box.offsetY, box.radiusY, height, startY, endY);
+
+	uint32 A = (startX >= 0 && startY >= 0) ? SAT[startY*width + startX] : 0;
+	uint32 B = (startY >= 0) ? SAT[startY*width + endX] : 0;
+	uint32 C = (startX >= 0) ? SAT[endY*width + startX] : 0;
+	uint32 D = SAT[endY*width + endX];
+
+	A &= maxValue;
+	B &= maxValue;
+	C &= maxValue;
+	D &= maxValue;
+
+	// TODO: should we do it as float? i feel like "yes" because shaders will do that, but i don't think the wrap around works there? dunno...
+#if 0
+	// Note that double can perfectly represent any uint32, but it's a float when a shader gets it
+	float fA = float(double(A) / double(maxValue));
+	float fB = float(double(B) / double(maxValue));
+	float fC = float(double(C) / double(maxValue));
+	float fD = float(double(D) / double(maxValue));
+
+	fA *= float(scale);
+	fB *= float(scale);
+	fC *= float(scale);
+	fD *= float(scale);
+
+	float integratedValue = fA + fD - fB - fC;
+
+	float size = float((endY - startY)*(endX - startX));
+
+	return uint8(0.5 + double(maxValue) * double(integratedValue / size));
+#else
+	uint32 integratedValue = A + D - B - C;
+	integratedValue *= scale;
+	integratedValue &= maxValue;
+
+	return uint8(0.5 + c_reciprocalRoundingNudge + double(integratedValue) * reciprocalArea);
+#endif
+}
+
+template <typename T>
+inline uint8 SATBoxBlurPixel(const T* SAT, int width, int height, int radius, int ix, int iy, int scale, uint32 maxValue, double reciprocalArea)
+{
+	return SATBoxBlurPixel(SAT, width, height, BlurBox{ radius, radius }, ix, iy, scale, maxValue, reciprocalArea);
+}
+
+// Processes a span of interior pixels, where no corner needs clamping, so the four corners of neighboring pixels are
+// neighboring table entries. A points at the top left corner of the first pixel, C at the bottom left, and the right
+// corners are diameter entries further along. Returns how many pixels were written, which may be less than count.
+typedef int(*SATBoxBlurInteriorKernel)(const uint32* A, const uint32* C, int diameter, int count, uint32 scale, uint32 maxValue, double reciprocalArea, uint8* result);
+
+int SATBoxBlurInterior_Scalar(const uint32* A, const uint32* C, int diameter, int count, uint32 scale, uint32 maxValue, double reciprocalArea, uint8* result)
+{
+    for (int index = 0; index < count; ++index)
+    {
+        uint32 integratedValue = (A[index] & maxValue) + (C[index + diameter] & maxValue) - (A[index + diameter] & maxValue) - (C[index] & maxValue);
+        integratedValue *= scale;
+        integratedValue &= maxValue;
+        result[index] = uint8(0.5 + c_reciprocalRoundingNudge + double(integratedValue) * reciprocalArea);
+    }
+    return count;
+}
+
+#if AAT_X86
+
+TARGET_AVX2 int SATBoxBlurInterior_AVX2(const uint32* A, const uint32* C, int diameter, int count, uint32 scale, uint32 maxValue, double reciprocalArea, uint8* result)
+{
+    const __m256i mask = _mm256_set1_epi32(int(maxValue));
+    const __m256i scaleV = _mm256_set1_epi32(int(scale));
+    const __m256i signBit = _mm256_set1_epi32(int(0x80000000));
+    const __m256d twoToThe31 = _mm256_set1_pd(2147483648.0);
+    const __m256d reciprocal = _mm256_set1_pd(reciprocalArea);
+    const __m256d half = _mm256_set1_pd(0.5 + c_reciprocalRoundingNudge);
+    const __m128i lowBytes = _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+
+    int index = 0;
+    for (; index + 8 <= count; index += 8)
+    {
+        __m256i a = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)&A[index]), mask);
+        __m256i b = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)&A[index + diameter]), mask);
+        __m256i c = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)&C[index]), mask);
+        __m256i d = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)&C[index + diameter]), mask);
+
+        // wrapping uint32 math, same as the scalar path
+        __m256i integratedValue = _mm256_sub_epi32(_mm256_sub_epi32(_mm256_add_epi32(a, d), b), c);
+        integratedValue = _mm256_and_si256(_mm256_mullo_epi32(integratedValue, scaleV), mask);
+
+        // there is no unsigned int to double conversion, so flip the sign bit, convert as signed, and add 2^31 back
+        __m256i biased = _mm256_xor_si256(integratedValue, signBit);
+        __m256d lo = _mm256_add_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(biased)), twoToThe31);
+        __m256d hi = _mm256_add_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(biased, 1)), twoToThe31);
+
+        __m128i loInt = _mm_shuffle_epi8(_mm256_cvttpd_epi32(_mm256_add_pd(_mm256_mul_pd(lo, reciprocal), half)), lowBytes);
+        __m128i hiInt = _mm_shuffle_epi8(_mm256_cvttpd_epi32(_mm256_add_pd(_mm256_mul_pd(hi, reciprocal), half)), lowBytes);
+
+        _mm_storel_epi64((__m128i*)&result[index], _mm_unpacklo_epi32(loInt, hiInt));
+    }
+    return index;
+}
+
+TARGET_SSE41 int SATBoxBlurInterior_SSE41(const uint32* A, const uint32* C, int diameter, int count, uint32 scale, uint32 maxValue, double reciprocalArea, uint8* result)
+{
+    const __m128i mask = _mm_set1_epi32(int(maxValue));
+    const __m128i scaleV = _mm_set1_epi32(int(scale));
+    const __m128i signBit = _mm_set1_epi32(int(0x80000000));
+    const __m128d twoToThe31 = _mm_set1_pd(2147483648.0);
+    const __m128d reciprocal = _mm_set1_pd(reciprocalArea);
+    const __m128d half = _mm_set1_pd(0.5 + c_reciprocalRoundingNudge);
+    const __m128i lowBytes = _mm_setr_epi8(0, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+
+    int index = 0;
+    for (; index + 4 <= count; index += 4)
+    {
+        __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i*)&A[index]), mask);
+        __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i*)&A[index + diameter]), mask);
+        __m128i c = _mm_and_si128(_mm_loadu_si128((const __m128i*)&C[index]), mask);
+        __m128i d = _mm_and_si128(_mm_loadu_si128((const __m128i*)&C[index + diameter]), mask);
+
+        __m128i integratedValue = _mm_sub_epi32(_mm_sub_epi32(_mm_add_epi32(a, d), b), c);
+        integratedValue = _mm_and_si128(_mm_mullo_epi32(integratedValue, scaleV), mask);
+
+        __m128i biased = _mm_xor_si128(integratedValue, signBit);
+        __m128d lo = _mm_add_pd(_mm_cvtepi32_pd(biased), twoToThe31);
+        __m128d hi = _mm_add_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(biased, biased)), twoToThe31);
+
+        __m128i loInt = _mm_shuffle_epi8(_mm_cvttpd_epi32(_mm_add_pd(_mm_mul_pd(lo, reciprocal), half)), lowBytes);
+        __m128i hiInt = _mm_shuffle_epi8(_mm_cvttpd_epi32(_mm_add_pd(_mm_mul_pd(hi, reciprocal), half)), lowBytes);
+
+        int packed = _mm_cvtsi128_si32(_mm_unpacklo_epi16(loInt, hiInt));
+        memcpy(&result[index], &packed, 4);
+    }
+    return index;
+}
+
+#endif // AAT_X86
+
+SATBoxBlurInteriorKernel GetSATBoxBlurInteriorKernel()
+{
+#if AAT_X86
+    if (g_allowSIMD && GetCPUFeatures().avx2)
+        return SATBoxBlurInterior_AVX2;
+    if (g_allowSIMD && GetCPUFeatures().sse41)
+        return SATBoxBlurInterior_SSE41;
+#endif
+    return SATBoxBlurInterior_Scalar;
+}
+
+// The same interior kernels for 16 bit tables, which wrap around at 2^16 and are masked down to numBits like the 32 bit ones
+typedef int(*SATBoxBlurInterior16Kernel)(const uint16* A, const uint16* C, int diameter, int count, uint32 scale, uint32 maxValue, double reciprocalArea, uint8* result);
+
+int SATBoxBlurInterior16_Scalar(const uint16* A, const uint16* C, int diameter, int count, uint32 scale, uint32 maxValue, double reciprocalArea, uint8* result)
+{
+    for (int index = 0; index < count; ++index)
+    {
+        uint32 integratedValue = (A[index] & maxValue) + (C[index + diameter] & maxValue) - (A[index + diameter] & maxValue) - (C[index] & maxValue);
+        integratedValue *= scale;
+        integratedValue &= maxValue;
+        result[index] = uint8(0.5 + c_reciprocalRoundingNudge + double(integratedValue) * reciprocalArea);
+    }
+    return count;
+}
+
+#if AAT_X86
+TARGET_AVX2 int SATBoxBlurInterior16_AVX2(const uint16* A, const uint16* C, int diameter, int count, uint32 scale, uint32 maxValue, double reciprocalArea, uint8* result)
+{
+    const __m256i mask = _mm256_set1_epi32(int(maxValue));
+    const __m256i scaleV = _mm256_set1_epi32(int(scale));
+    const __m256d reciprocal = _mm256_set1_pd(reciprocalArea);
+    const __m256d half = _mm256_set1_pd(0.5 + c_reciprocalRoundingNudge);
+    const __m128i lowBytes = _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+
+    int index = 0;
+    for (; index + 8 <= count; index += 8)
+    {
+        __m256i a = _mm256_and_si256(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)&A[index])), mask);
+        __m256i b = _mm256_and_si256(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)&A[index + diameter])), mask);
+        __m256i c = _mm256_and_si256(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)&C[index])), mask);
+        __m256i d = _mm256_and_si256(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)&C[index + diameter])), mask);
+
+        __m256i integratedValue = _mm256_sub_epi32(_mm256_sub_epi32(_mm256_add_epi32(a, d), b), c);
+        integratedValue = _mm256_and_si256(_mm256_mullo_epi32(integratedValue, scaleV), mask);
+
+        // maxValue is at most 16 bits here, so the values convert to double as signed ints
+        __m256d lo = _mm256_cvtepi32_pd(_mm256_castsi256_si128(integratedValue));
+        __m256d hi = _mm256_cvtepi32_pd(_mm256_extracti128_si256(integratedValue, 1));
+
+        __m128i loInt = _mm_shuffle_epi8(_mm256_cvttpd_epi32(_mm256_add_pd(_mm256_mul_pd(lo, reciprocal), half)), lowBytes);
+        __m128i hiInt = _mm_shuffle_epi8(_mm256_cvttpd_epi32(_mm256_add_pd(_mm256_mul_pd(hi, reciprocal), half)), lowBytes);
+
+        _mm_storel_epi64((__m128i*)&result[index], _mm_unpacklo_epi32(loInt, hiInt));
+    }
+    return index;
+}
+#endif // AAT_X86
+
+SATBoxBlurInterior16Kernel GetSATBoxBlurInterior16Kernel()
+{
+#if AAT_X86
+    if (g_allowSIMD && GetCPUFeatures().avx2)
+        return SATBoxBlurInterior16_AVX2;
+#endif
+    return SATBoxBlurInterior16_Scalar;
+}
+
+void SATBoxBlurImage(const uint16* SAT, int width, int height, int radius, int scale, int numBits, std::vector<uint8>& result, const BlurOptions& options)
+{
+	result.resize(width * height);
+
+	uint32 maxValue = uint32(1 << std::min(numBits, 16)) - 1;
+
+	int diameter = radius * 2 + 1;
+
+	SATBoxBlurInterior16Kernel interiorKernel = GetSATBoxBlurInterior16Kernel();
+
+	BoxAreaReciprocals areas(width, height, radius);
+
+	ForEachBlurPixel(width, height, radius, options,
+		[&](int ix, int iy)
+		{
+			result[iy*width + ix] = SATBoxBlurPixel(SAT, width, height, radius, ix, iy, scale, maxValue, areas.Area(ix, iy));
+		},
+		[&](int ix, int iy, int count)
+		{
+			const uint16* A = &SAT[(iy - radius - 1)*width + ix - radius - 1];
+			const uint16* C = &SAT[(iy + radius)*width + ix - radius - 1];
+			return interiorKernel(A, C, diameter, count, uint32(scale), maxValue, areas.interior, &result[iy*width + ix]);
+		}
+	);
+}
+
+void SATBoxBlurImage(const uint32* SAT, int width, int height, const BlurBox& box, int scale, int numBits, std::vector<uint8>& result, const BlurOptions& options)
+{
+	result.resize(width * height);
+
+	uint32 maxValue = numBits == 32 ? uint32(-1) : uint32(1 << numBits) - 1;
+
+	int boxWidth = box.radiusX * 2 + 1;
+	int left = box.offsetX - box.radiusX - 1;
+	int top = box.offsetY - box.radiusY - 1;
+	int bottom = box.offsetY + box.radiusY;
+
+	SATBoxBlurInteriorKernel interiorKernel = GetSATBoxBlurInteriorKernel();
+
+	BoxAreaReciprocals areas(width, height, box);
+
+	ForEachBlurPixel(width, height, box, options,
+		[&](int ix, int iy)
+		{
+			result[iy*width + ix] = SATBoxBlurPixel(SAT, width, height, box, ix, iy, scale, maxValue, areas.Area(ix, iy));
+		},
+		[&](int ix, int iy, int count)
+		{
+			const uint32* A = &SAT[(iy + top)*width + ix + left];
+			const uint32* C = &SAT[(iy + bottom)*width + ix + left];
+			return interiorKernel(A, C, boxWidth, count, uint32(scale), maxValue, areas.interior, &result[iy*width + ix]);
+		}
+	);
+}
+
+void SATBoxBlurImage(const uint32* SAT, int width, int height, int radius, int scale, int numBits, std::vector<uint8>& result, const BlurOptions& options)
+{
+	SATBoxBlurImage(SAT, width, height, BlurBox{ radius, radius }, scale, numBits, result, options);
+}
+
+void SATBoxBlurImage(const std::vector<uint32>& SAT, int width, int height, int radius, int scale, int numBits, std::vector<uint8>& result, const BlurOptions& options)
+{
+	SATBoxBlurImage(&SAT[0], width, height, radius, scale, numBits, result, options);
+}
+
+void SATBoxBlurImage(const std::vector<uint32>& SAT, int width, int height, const BlurBox& box, int scale, int numBits, std::vector<uint8>& result, const BlurOptions& options)
+{
+	SATBoxBlurImage(&SAT[0], width, height, box, scale, numBits, result, options);
+}
+
+// ------------------ Hierarchical SATs ------------------
+
+inline int HierarchicalSATGridIndex(int position, int stride, int size)
+{
+    // the last row / column is a grid point even when it isn't a multiple of the stride
+    return (position == size - 1 && position % stride != 0) ? (size - 1 + stride - 1) / stride : position / stride;
+}
+
+uint32 HierarchicalSATReconstruct(const HierarchicalSAT& table, int level, int x, int y);
+
+// Bilinearly interpolates the reconstructed values of a level at any texel. Done in integers so it is exactly repeatable.
+uint32 HierarchicalSATPredict(const HierarchicalSAT& table, int level, int x, int y)
+{
+    int stride = table.levels[level].stride;
+
+    int x0 = (x / stride) * stride;
+    int x1 = std::min(x0 + stride, table.width - 1);
+    int y0 = (y / stride) * stride;
+    int y1 = std::min(y0 + stride, table.height - 1);
+
+    // on a grid line of this level, so only interpolate along the other axis (or not at all)
+    if (x == x0)
+        x1 = x0;
+    if (y == y0)
+        y1 = y0;
+
+    int64_t v00 = HierarchicalSATReconstruct(table, level, x0, y0);
+    int64_t v10 = (x1 != x0) ? HierarchicalSATReconstruct(table, level, x1, y0) : v00;
+    int64_t v01 = (y1 != y0) ? HierarchicalSATReconstruct(table, level, x0, y1) : v00;
+    int64_t v11 = (x1 != x0 && y1 != y0) ? HierarchicalSATReconstruct(table, level, x1, y1) : ((x1 != x0) ? v10 : v01);
+
+    int64_t lengthX = std::max(x1 - x0, 1);
+    int64_t lengthY = std::max(y1 - y0, 1);
+    int64_t tx = x - x0;
+    int64_t ty = y - y0;
+
+    int64_t weighted = v00 * (lengthX - tx) * (lengthY - ty) + v10 * tx * (lengthY - ty) + v01 * (lengthX - tx) * ty + v11 * tx * ty;
+    int64_t area = lengthX * lengthY;
+    return uint32((weighted + area / 2) / area);
+}
+
+// Returns the exact SAT value at a grid point of the given level
+uint32 HierarchicalSATReconstruct(const HierarchicalSAT& table, int level, int x, int y)
+{
+    const HierarchicalSAT::Level& levelData = table.levels[level];
+    int gx = HierarchicalSATGridIndex(x, levelData.stride, table.width);
+    int gy = HierarchicalSATGridIndex(y, levelData.stride, table.height);
+    uint32 stored = uint32(levelData.values[gy * levelData.gridWidth + gx]);
+
+    if (level == 0)
+        return stored;
+
+    return HierarchicalSATPredict(table, level - 1, x, y) + stored;
+}
+
+uint32 QueryHierarchicalSAT(const HierarchicalSAT& table, int x, int y)
+{
+    return HierarchicalSATReconstruct(table, int(table.levels.size()) - 1, x, y);
+}
+
+void BuildHierarchicalSAT(const std::vector<uint32>& SAT, int width, int height, int blockSize, int numLevels, HierarchicalSAT& table)
+{
+    table.width = width;
+    table.height = height;
+    table.blockSize = blockSize;
+    table.levels.clear();
+    table.levels.resize(numLevels);
+
+    int stride = 1;
+    for (int level = numLevels - 1; level >= 0; --level)
+    {
+        table.levels[level].stride = stride;
+        table.levels[level].gridWidth = (width - 1 + stride - 1) / stride + 1;
+        table.levels[level].gridHeight = (height - 1 + stride - 1) / stride + 1;
+        stride *= blockSize;
+    }
+
+    // coarse to fine, so each level can predict from the finished levels above it
+    for (int level = 0; level < numLevels; ++level)
+    {
+        HierarchicalSAT::Level& levelData = table.levels[level];
+        levelData.values.resize(levelData.gridWidth * levelData.gridHeight);
+
+        int32 minValue = 0;
+        int32 maxValue = 0;
+        uint32 maxUnsigned = 0;
+        for (int gy = 0; gy < levelData.gridHeight; ++gy)
+        {
+            int y = std::min(gy * levelData.stride, height - 1);
+            for (int gx = 0; gx < levelData.gridWidth; ++gx)
+            {
+                int x = std::min(gx * levelData.stride, width - 1);
+                uint32 value = SAT[y*width + x];
+                if (level > 0)
+                    value -= HierarchicalSATPredict(table, level - 1, x, y);
+
+                int32 stored = int32(value);
+                levelData.values[gy * levelData.gridWidth + gx] = stored;
+                minValue = std::min(minValue, stored);
+                maxValue = std::max(maxValue, stored);
+                maxUnsigned = std::max(maxUnsigned, value);
+            }
+        }
+
+        // level 0 is unsigned SAT values, the rest are signed differences
+        if (level == 0)
+        {
+            levelData.numBits = 0;
+            while (levelData.numBits < 32 && (uint64_t(1) << levelData.numBits) <= maxUnsigned)
+                levelData.numBits++;
+        }
+        else
+        {
+            levelData.numBits = 1;
+            while (levelData.numBits < 32 && (minValue < -(int64_t(1) << (levelData.numBits - 1)) || maxValue >= (int64_t(1) << (levelData.numBits - 1))))
+                levelData.numBits++;
+        }
+    }
+}
+
+double HierarchicalSATBitsPerTexel(const HierarchicalSAT& table)
+{
+    double totalBits = 0.0;
+    for (const HierarchicalSAT::Level& level : table.levels)
+        totalBits += double(level.gridWidth) * double(level.gridHeight) * double(level.numBits);
+    return totalBits / (double(table.width) * double(table.height));
+}
+
+void HierarchicalSATBoxBlurImage(const HierarchicalSAT& table, int width, int height, int radius, std::vector<uint8>& result)
+{
+	result.resize(width * height);
+
+	BoxAreaReciprocals areas(width, height, radius);
+
+	for (int iy = 0; iy < height; ++iy)
+	{
+		for (int ix = 0; ix < width; ++ix)
+		{
+			int startX = std::max(ix - radius - 1, -1);
+			int startY = std::max(iy - radius - 1, -1);
+
+			int endX = std::min(ix + radius, width - 1);
+			int endY = std::min(iy + radius, height - 1);
+
+			uint32 A = (startX >= 0 && startY >= 0) ? QueryHierarchicalSAT(table, startX, startY) : 0;
+			uint32 B = (startY >= 0) ? QueryHierarchicalSAT(table, endX, startY) : 0;
+			uint32 C = (startX >= 0) ? QueryHierarchicalSAT(table, startX, endY) : 0;
+			uint32 D = QueryHierarchicalSAT(table, endX, endY);
+
+			uint32 integratedValue = A + D - B - C;
+
+			result[iy*width + ix] = uint8(0.5 + c_reciprocalRoundingNudge + double(integratedValue) * areas.Area(ix, iy));
+		}
+	}
+}
+
+// The AAT blurs divide a float by the area, like a shader would. The product with a double reciprocal is within a
+// couple of double ulps of the quotient, which is too close to round to a different float than the float divide does
+// for any box under 2^20 pixels, so rounding it to float gives the same result.
+inline float AATDivideByArea(float value, double reciprocalArea)
+{
+	return float(double(value) * reciprocalArea);
+}
+
+// The blurred value of a pixel before it is rounded to uint8
+inline float AATBoxBlurValue(const uint32* AAT, int width, int height, const BlurBox& box, int ix, int iy, int scale, double reciprocalArea)
+{
+	int startX, startY, endX, endY;
+	BoxAxisRange(ix, box.offsetX, box.radiusX, width, startX, endX);
+	BoxAxisRange(iy, box.offsetY, box.radiusY, height, startY, endY);
+
+    // This function aims to mimic unorm and shader behaviors.
+    // * Scale implicitly describes the number of bits of storage above 8. (eg 10 bit would have a scale of 4)
+    // * It converts to float because that's what shaders work in.
+    // * It multiplies by area after converting to float because that's when shaders would be able to do their work to turn an average back into an area.
+
+	float A = float((startX >= 0 && startY >= 0) ? AAT[startY*width + startX] : 0) / float(256 * scale);
+    A *= float((startY + 1)*(startX + 1));
+
+    float B = float((startY >= 0) ? AAT[startY*width + endX] : 0) / float(256 * scale);
+    B *= float((startY + 1)*(endX + 1));
+
+    float C = float((startX >= 0) ? AAT[endY*width + startX] : 0) / float(256 * scale);
+    C *= float((endY + 1)*(startX + 1));
+
+    float D = float(AAT[endY*width + endX]) / float(256 * scale);
+    D *= float((endY + 1)*(endX + 1));
+
+	float integratedValue = A + D - B - C;
+
+	return AATDivideByArea(255.0f * integratedValue, reciprocalArea);
+}
+
+inline float AATBoxBlurValue(const uint32* AAT, int width, int height, int radius, int ix, int iy, int scale, double reciprocalArea)
+{
+	return AATBoxBlurValue(AAT, width, height, BlurBox{ radius, radius }, ix, iy, scale, reciprocalArea);
+}
+
+inline uint8 AATBoxBlurPixel(const uint32* AAT, int width, int height, const BlurBox& box, int ix, int iy, int scale, double reciprocalArea)
+{
+	return uint8(0.5f + AATBoxBlurValue(AAT, width, height, box, ix, iy, scale, reciprocalArea));
+}
+
+inline uint8 AATBoxBlurPixel(const uint32* AAT, int width, int height, int radius, int ix, int iy, int scale, double reciprocalArea)
+{
+	return AATBoxBlurPixel(AAT, width, height, BlurBox{ radius, radius }, ix, iy, scale, reciprocalArea);
+}
+
+// Same math as AATBoxBlurPixel, in the same order so the results are bit identical, without the clamping.
+// A and C point at the top left and bottom left corners of the first pixel, which is at table column startX + 1.
+// Each corner in a row is the left corner of one pixel and the right corner of the pixel diameter to its left, for any
+// box width, so the corner values are worked out once per column into rowScratch, which has room for
+// 2 * (count + diameter) floats. That halves the loads, converts and divides of doing four corners per pixel.
+int AATBoxBlurInterior(const uint32* A, const uint32* C, int diameter, int count, int startX, int startY, int endY, int scale, double reciprocalArea, float* rowScratch, uint8* result)
+{
+	int columns = count + diameter;
+	float* top = rowScratch;
+	float* bottom = &rowScratch[columns];
+
+	float divisor = float(256 * scale);
+	for (int index = 0; index < columns; ++index)
+	{
+		int cornerX = startX + index;
+
+		top[index] = float(A[index]) / divisor;
+		top[index] *= float((startY + 1)*(cornerX + 1));
+
+		bottom[index] = float(C[index]) / divisor;
+		bottom[index] *= float((endY + 1)*(cornerX + 1));
+	}
+
+	for (int index = 0; index < count; ++index)
+	{
+		float integratedValue = top[index] + bottom[index + diameter] - top[index + diameter] - bottom[index];
+		result[index] = uint8(0.5f + AATDivideByArea(255.0f * integratedValue, reciprocalArea));
+	}
+	return count;
+}
+
+void AATBoxBlurImage(const uint32* AAT, int width, int height, const BlurBox& box, int scale, std::vector<uint8>& result, const BlurOptions& options)
+{
+	result.resize(width * height);
+
+	int boxWidth = box.radiusX * 2 + 1;
+
+	std::vector<float> rowScratch(2 * (width + 1));
+
+	BoxAreaReciprocals areas(width, height, box);
+
+	ForEachBlurPixel(width, height, box, options,
+		[&](int ix, int iy)
+		{
+			result[iy*width + ix] = AATBoxBlurPixel(AAT, width, height, box, ix, iy, scale, areas.Area(ix, iy));
+		},
+		[&](int ix, int iy, int count)
+		{
+			int startX = ix + box.offsetX - box.radiusX - 1;
+			int startY = iy + box.offsetY - box.radiusY - 1;
+			int endY = iy + box.offsetY + box.radiusY;
+			const uint32* A = &AAT[startY*width + startX];
+			const uint32* C = &AAT[endY*width + startX];
+			return AATBoxBlurInterior(A, C, boxWidth, count, startX, startY, endY, scale, areas.interior, &rowScratch[0], &result[iy*width + ix]);
+		}
+	);
+}
+
+void AATBoxBlurImage(const uint32* AAT, int width, int height, int radius, int scale, std::vector<uint8>& result, const BlurOptions& options)
+{
+	AATBoxBlurImage(AAT, width, height, BlurBox{ radius, radius }, scale, result, options);
+}
+
+void AATBoxBlurImage(const std::vector<uint32>& AAT, int width, int height, int radius, int scale, std::vector<uint8>& result, const BlurOptions& options)
+{
+	AATBoxBlurImage(&AAT[0], width, height, radius, scale, result, options);
+}
+
+void AATBoxBlurImage(const std::vector<uint32>& AAT, int width, int height, const BlurBox& box, int scale, std::vector<uint8>& result, const BlurOptions& options)
+{
+	AATBoxBlurImage(&AAT[0], width, height, box, scale, result, options);
+}
+
+// Divides by a constant with a multiply and a shift instead of a divide. For numerators below 256 * divisor, the
+// product fits in 64 bits and is the quotient or 1 less, which one compare against the remainder fixes.
+// Exact for divisors below 2^48.
+struct IntegerReciprocal
+{
+    explicit IntegerReciprocal(uint64_t divisor_)
+        : divisor(divisor_)
+        , multiplier((uint64_t(1) << 56) / divisor_)
+    {
+    }
+
+    uint64_t Divide(uint64_t numerator) const
+    {
+        uint64_t quotient = (numerator * multiplier) >> 56;
+        return quotient + ((numerator - quotient * divisor) >= divisor ? 1 : 0);
+    }
+
+    uint64_t divisor;
+    uint64_t multiplier;
+};
+
+// The box sum from an AAT in integers, scale times too big. Each corner's value is multiplied by the area of the
+// rectangle it is the average of, which gives back its SAT value to within half of that area.
+inline int64_t AATBoxSumInteger(int64_t A, int64_t B, int64_t C, int64_t D, int startX, int startY, int endX, int endY)
+{
+    return int64_t(startY + 1) * (A * (startX + 1) - B * (endX + 1)) + int64_t(endY + 1) * (D * (endX + 1) - C * (startX + 1));
+}
+
+// Rounds sum / divisor to 8 bits, clamping the AAT's rounding error into 0 to 255.
+// With divisor d, that is floor((2 * sum + d) / (2 * d)), which is what reciprocal divides by 2 * d.
+inline uint8 AATBoxAverageInteger(int64_t sum, int64_t divisor, const IntegerReciprocal& reciprocal)
+{
+    int64_t numerator = std::min(std::max(sum * 2 + divisor, int64_t(0)), divisor * 512 - 1);
+    return uint8(reciprocal.Divide(uint64_t(numerator)));
+}
+
+// fixedReciprocalArea is BoxAreaReciprocals::FixedArea, and twiceScaleReciprocal divides by 2 * scale
+inline uint8 AATBoxBlurPixelInteger(const uint32* AAT, int width, int height, int radius, int ix, int iy, int scale, uint64_t fixedReciprocalArea, const IntegerReciprocal& twiceScaleReciprocal)
+{
+	int startX = std::max(ix - radius - 1, -1);
+	int startY = std::max(iy - radius - 1, -1);
+
+	int endX = std::min(ix + radius, width - 1);
+	int endY = std::min(iy + radius, height - 1);
+
+	uint32 A = (startX >= 0 && startY >= 0) ? AAT[startY*width + startX] : 0;
+	uint32 B = (startY >= 0) ? AAT[startY*width + endX] : 0;
+	uint32 C = (startX >= 0) ? AAT[endY*width + startX] : 0;
+	uint32 D = AAT[endY*width + endX];
+
+	int64_t sum = AATBoxSumInteger(A, B, C, D, startX, startY, endX, endY);
+
+	// Border pixels each have their own area. Multiplying by the fixed point 1 / area and then dividing by 2 * scale
+	// gives the quotient or a little less, as the reciprocal rounds down, and the remainder corrects it.
+	// The numerator is up to 2^9 * scale * area, so at large scales the product with the reciprocal (about 2^32 / area)
+	// doesn't fit in 64 bits. It is multiplied a 32 bit half at a time, which gives the same bits as the full product.
+	int64_t divisor = int64_t(scale) * int64_t((endY - startY)*(endX - startX));
+	uint64_t numerator = uint64_t(std::min(std::max(sum * 2 + divisor, int64_t(0)), divisor * 512 - 1));
+	uint64_t numeratorTimesReciprocal = (numerator >> 32) * fixedReciprocalArea + (((numerator & 0xffffffff) * fixedReciprocalArea) >> 32);
+	uint64_t quotient = twiceScaleReciprocal.Divide(numeratorTimesReciprocal);
+	uint64_t remainder = numerator - quotient * uint64_t(divisor * 2);
+	while (remainder >= uint64_t(divisor * 2))
+	{
+		quotient++;
+		remainder -= uint64_t(divisor * 2);
+	}
+	return uint8(quotient);
+}
+
+// A and C point at the top left and bottom left corners of the first pixel, which is at table column startX + 1.
+// AATBoxSumInteger regrouped by column: each column's bottom corner SAT value minus its top one is worked out once into
+// columnSums, which has room for count + diameter values, and a pixel's sum is its right column's less its left's.
+// The row areas are the same for the whole span. The integer math is exact, so the sums are the same either way.
+int AATBoxBlurInteriorInteger(const uint32* A, const uint32* C, int diameter, int count, int startX, int startY, int endY, int64_t divisor, const IntegerReciprocal& reciprocal, int64_t* columnSums, uint8* result)
+{
+	int64_t topArea = int64_t(startY + 1);
+	int64_t bottomArea = int64_t(endY + 1);
+	for (int index = 0; index < count + diameter; ++index)
+		columnSums[index] = int64_t(startX + index + 1) * (bottomArea * C[index] - topArea * A[index]);
+
+	for (int index = 0; index < count; ++index)
+		result[index] = AATBoxAverageInteger(columnSums[index + diameter] - columnSums[index], divisor, reciprocal);
+	return count;
+}
+
+void AATBoxBlurImageInteger(const uint32* AAT, int width, int height, int radius, int scale, std::vector<uint8>& result, const BlurOptions& options)
+{
+	result.resize(width * height);
+
+	int diameter = radius * 2 + 1;
+
+	int64_t divisor = int64_t(scale) * int64_t(diameter * diameter);
+	IntegerReciprocal reciprocal(uint64_t(divisor) * 2);
+	IntegerReciprocal twiceScaleReciprocal(uint64_t(scale) * 2);
+
+	BoxAreaReciprocals areas(width, height, radius);
+
+	std::vector<int64_t> columnSums(width + 1);
+
+	ForEachBlurPixel(width, height, radius, options,
+		[&](int ix, int iy)
+		{
+			result[iy*width + ix] = AATBoxBlurPixelInteger(AAT, width, height, radius, ix, iy, scale, areas.FixedArea(ix, iy), twiceScaleReciprocal);
+		},
+		[&](int ix, int iy, int count)
+		{
+			int startX = ix - radius - 1;
+			int startY = iy - radius - 1;
+			int endY = iy + radius;
+			return AATBoxBlurInteriorInteger(&AAT[startY*width + startX], &AAT[endY*width + startX], diameter, count, startX, startY, endY, divisor, reciprocal, &columnSums[0], &result[iy*width + ix]);
+		}
+	);
+}
+
+void AATBoxBlurImageInteger(const std::vector<uint32>& AAT, int width, int height, int radius, int scale, std::vector<uint8>& result, const BlurOptions& options)
+{
+	AATBoxBlurImageInteger(&AAT[0], width, height, radius, scale, result, options);
+}
+
+// ------------------ Multi radius blurs ------------------
+
+// Sizes the results and makes the area reciprocals of each radius
+void PrepareMultiRadiusBlur(int width, int height, const int* radiuses, int numRadiuses, std::vector<std::vector<uint8>>& results, std::vector<BoxAreaReciprocals>& areas)
+{
+    results.resize(numRadiuses);
+    areas.clear();
+    for (int index = 0; index < numRadiuses; ++index)
+    {
+        results[index].resize(width * height);
+        areas.emplace_back(width, height, radiuses[index]);
+    }
+}
+
+void SATBoxBlurImageMultiRadius(const std::vector<uint32>& SAT, int width, int height, const int* radiuses, int numRadiuses, int scale, int numBits, std::vector<std::vector<uint8>>& results, const BlurOptions& options)
+{
+	std::vector<BoxAreaReciprocals> areas;
+	PrepareMultiRadiusBlur(width, height, radiuses, numRadiuses, results, areas);
+
+	uint32 maxValue = numBits == 32 ? uint32(-1) : uint32(1 << numBits) - 1;
+
+	SATBoxBlurInteriorKernel interiorKernel = GetSATBoxBlurInteriorKernel();
+
+	ForEachBlurPixelMultiRadius(width, height, radiuses, numRadiuses, options,
+		[&](int index, int ix, int iy)
+		{
+			results[index][iy*width + ix] = SATBoxBlurPixel(&SAT[0], width, height, radiuses[index], ix, iy, scale, maxValue, areas[index].Area(ix, iy));
+		},
+		[&](int index, int ix, int iy, int count)
+		{
+			int radius = radiuses[index];
+			const uint32* A = &SAT[(iy - radius - 1)*width + ix - radius - 1];
+			const uint32* C = &SAT[(iy + radius)*width + ix - radius - 1];
+			return interiorKernel(A, C, radius * 2 + 1, count, uint32(scale), maxValue, areas[index].interior, &results[index][iy*width + ix]);
+		}
+	);
+}
+
+void SATBoxBlurBiasedImageMultiRadius(const std::vector<int32>& SAT, int width, int height, const int* radiuses, int numRadiuses, int bias, std::vector<std::vector<uint8>>& results, const BlurOptions& options)
+{
+	std::vector<BoxAreaReciprocals> areas;
+	PrepareMultiRadiusBlur(width, height, radiuses, numRadiuses, results, areas);
+
+	ForEachBlurPixelMultiRadius(width, height, radiuses, numRadiuses, options,
+		[&](int index, int ix, int iy)
+		{
+			results[index][iy*width + ix] = SATBoxBlurBiasedPixel(&SAT[0], width, height, radiuses[index], ix, iy, bias, areas[index].Area(ix, iy));
+		},
+		[&](int index, int ix, int iy, int count)
+		{
+			int radius = radiuses[index];
+			const int32* A = &SAT[(iy - radius - 1)*width + ix - radius - 1];
+			const int32* C = &SAT[(iy + radius)*width + ix - radius - 1];
+			return SATBoxBlurBiasedInterior(A, C, radius * 2 + 1, count, bias, areas[index].interior, &results[index][iy*width + ix]);
+		}
+	);
+}
+
+void AATBoxBlurImageMultiRadius(const std::vector<uint32>& AAT, int width, int height, const int* radiuses, int numRadiuses, int scale, std::vector<std::vector<uint8>>& results, const BlurOptions& options)
+{
+	std::vector<BoxAreaReciprocals> areas;
+	PrepareMultiRadiusBlur(width, height, radiuses, numRadiuses, results, areas);
+
+	std::vector<float> rowScratch(2 * (width + 1));
+
+	ForEachBlurPixelMultiRadius(width, height, radiuses, numRadiuses, options,
+		[&](int index, int ix, int iy)
+		{
+			results[index][iy*width + ix] = AATBoxBlurPixel(&AAT[0], width, height, radiuses[index], ix, iy, scale, areas[index].Area(ix, iy));
+		},
+		[&](int index, int ix, int iy, int count)
+		{
+			int radius = radiuses[index];
+			int startX = ix - radius - 1;
+			int startY = iy - radius - 1;
+			int endY = iy + radius;
+			return AATBoxBlurInterior(&AAT[startY*width + startX], &AAT[endY*width + startX], radius * 2 + 1, count, startX, startY, endY, scale, areas[index].interior, &rowScratch[0], &results[index][iy*width + ix]);
+		}
+	);
+}
+
+// ------------------ Half float (IEEE binary16) AATs ------------------
+
+// Software float <-> half conversions, for CPUs without F16C. FloatToHalf rounds to nearest even, like F16C does.
+// Based on https://gist.github.com/rygorous/2156668
+uint16 FloatToHalf(float value)
+{
+    static const uint32 c_f32Infinity = 255 << 23;
+    static const uint32 c_f16Max = (127 + 16) << 23;
+    static const uint32 c_denormMagicBits = ((127 - 15) + (23 - 10) + 1) << 23;
+
+    uint32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint32 sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    uint16 ret;
+    if (bits >= c_f16Max)
+    {
+        // Inf or NaN
+        ret = (bits > c_f32Infinity) ? 0x7e00 : 0x7c00;
+    }
+    else if (bits < (113 << 23))
+    {
+        // becomes a half denormal. Adding the magic number lets the float hardware do the rounding.
+        float denormMagic;
+        memcpy(&denormMagic, &c_denormMagicBits, sizeof(denormMagic));
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        f += denormMagic;
+        memcpy(&bits, &f, sizeof(bits));
+        ret = uint16(bits - c_denormMagicBits);
+    }
+    else
+    {
+        uint32 mantissaOdd = (bits >> 13) & 1;
+        bits += (uint32(15 - 127) << 23) + 0xfff;
+        bits += mantissaOdd;
+        ret = uint16(bits >> 13);
+    }
+
+    return ret | uint16(sign >> 16);
+}
+
+float HalfToFloat(uint16 value)
+{
+    static const uint32 c_magicBits = 113 << 23;
+    static const uint32 c_shiftedExponent = 0x7c00 << 13;
+
+    uint32 bits = uint32(value & 0x7fff) << 13;
+    uint32 exponent = c_shiftedExponent & bits;
+    bits += (127 - 15) << 23;
+
+    float ret;
+    if (exponent == c_shiftedExponent)
+    {
+        // Inf or NaN
+        bits += (128 - 16) << 23;
+        memcpy(&ret, &bits, sizeof(ret));
+    }
+    else if (exponent == 0)
+    {
+        // zero or denormal
+        bits += 1 << 23;
+        float magic;
+        memcpy(&magic, &c_magicBits, sizeof(magic));
+        memcpy(&ret, &bits, sizeof(ret));
+        ret -= magic;
+    }
+    else
+    {
+        memcpy(&ret, &bits, sizeof(ret));
+    }
+
+    uint32 sign = uint32(value & 0x8000) << 16;
+    uint32 retBits;
+    memcpy(&retBits, &ret, sizeof(retBits));
+    retBits |= sign;
+    memcpy(&ret, &retBits, sizeof(ret));
+    return ret;
+}
+
+#if AAT_X86
+TARGET_F16C void FloatsToHalves_F16C(const float* source, uint16* dest, int count)
+{
+    int index = 0;
+    for (; index + 8 <= count; index += 8)
+        _mm_storeu_si128((__m128i*)&dest[index], _mm256_cvtps_ph(_mm256_loadu_ps(&source[index]), _MM_FROUND_TO_NEAREST_INT));
+    for (; index < count; ++index)
+        dest[index] = FloatToHalf(source[index]);
+}
+#endif
+
+void FloatsToHalves(const float* source, uint16* dest, int count)
+{
+#if AAT_X86
+    if (g_allowSIMD && GetCPUFeatures().f16c)
+    {
+        FloatsToHalves_F16C(source, dest, count);
+        return;
+    }
+#endif
+    for (int index = 0; index < count; ++index)
+        dest[index] = FloatToHalf(source[index]);
+}
+
+void BuildAATHalf(const std::vector<uint32>& SAT, int width, int height, std::vector<uint16>& AATHalf)
+{
+    AATHalf.resize(width * height);
+
+    std::vector<float> row;
+    row.resize(width);
+    for (int iy = 0; iy < height; ++iy)
+    {
+        for (int ix = 0; ix < width; ++ix)
+        {
+            double value = double(SAT[iy*width + ix]);
+            double rangeSize = double(ix + 1) * double(iy + 1);
+            row[ix] = float(value / rangeSize / 255.0);
+        }
+        FloatsToHalves(&row[0], &AATHalf[iy*width], width);
+    }
+}
+
+inline uint8 AATHalfBoxBlurPixel(const uint16* AAT, int width, int height, int radius, int ix, int iy, double reciprocalArea)
+{
+	int startX = std::max(ix - radius - 1, -1);
+	int startY = std::max(iy - radius - 1, -1);
+
+	int endX = std::min(ix + radius, width - 1);
+	int endY = std::min(iy + radius, height - 1);
+
+    // Same as AATBoxBlurPixel, but the half float is already a normalized float so there is no scale to divide out
+	float A = (startX >= 0 && startY >= 0) ? HalfToFloat(AAT[startY*width + startX]) : 0.0f;
+    A *= float((startY + 1)*(startX + 1));
+
+    float B = (startY >= 0) ? HalfToFloat(AAT[startY*width + endX]) : 0.0f;
+    B *= float((startY + 1)*(endX + 1));
+
+    float C = (startX >= 0) ? HalfToFloat(AAT[endY*width + startX]) : 0.0f;
+    C *= float((endY + 1)*(startX + 1));
+
+    float D = HalfToFloat(AAT[endY*width + endX]);
+    D *= float((endY + 1)*(endX + 1));
+
+	float integratedValue = A + D - B - C;
+
+	return uint8(0.5f + AATDivideByArea(255.0f * integratedValue, reciprocalArea));
+}
+
+// Same arguments as AATBoxBlurInterior
+typedef int(*AATHalfBoxBlurInteriorKernel)(const uint16* A, const uint16* C, int diameter, int count, int startX, int startY, int endY, double reciprocalArea, uint8* result);
+
+int AATHalfBoxBlurInterior_Scalar(const uint16* A, const uint16* C, int diameter, int count, int startX, int startY, int endY, double reciprocalArea, uint8* result)
+{
+	for (int index = 0; index < count; ++index)
+	{
+		int cornerStartX = startX + index;
+		int cornerEndX = cornerStartX + diameter;
+
+		float a = HalfToFloat(A[index]) * float((startY + 1)*(cornerStartX + 1));
+		float b = HalfToFloat(A[index + diameter]) * float((startY + 1)*(cornerEndX + 1));
+		float c = HalfToFloat(C[index]) * float((endY + 1)*(cornerStartX + 1));
+		float d = HalfToFloat(C[index + diameter]) * float((endY + 1)*(cornerEndX + 1));
+
+		float integratedValue = a + d - b - c;
+
+		result[index] = uint8(0.5f + AATDivideByArea(255.0f * integratedValue, reciprocalArea));
+	}
+	return count;
+}
+
+#if AAT_X86
+
+// 8 pixels at a time, doing the same float operations in the same order as the scalar version so results match exactly
+TARGET_AVX2_F16C int AATHalfBoxBlurInterior_AVX2_F16C(const uint16* A, const uint16* C, int diameter, int count, int startX, int startY, int endY, double reciprocalArea, uint8* result)
+{
+    const __m256i laneOffsets = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 8);
+    const __m256i diameterV = _mm256_set1_epi32(diameter);
+    const __m256i startYPlusOne = _mm256_set1_epi32(startY + 1);
+    const __m256i endYPlusOne = _mm256_set1_epi32(endY + 1);
+    const __m256d reciprocal = _mm256_set1_pd(reciprocalArea);
+    const __m256 c_255 = _mm256_set1_ps(255.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m128i lowBytes = _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+
+    int index = 0;
+    for (; index + 8 <= count; index += 8)
+    {
+        __m256i cornerStartXPlusOne = _mm256_add_epi32(_mm256_set1_epi32(startX + index), laneOffsets);
+        __m256i cornerEndXPlusOne = _mm256_add_epi32(cornerStartXPlusOne, diameterV);
+
+        __m256 a = _mm256_mul_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)&A[index])), _mm256_cvtepi32_ps(_mm256_mullo_epi32(startYPlusOne, cornerStartXPlusOne)));
+        __m256 b = _mm256_mul_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)&A[index + diameter])), _mm256_cvtepi32_ps(_mm256_mullo_epi32(startYPlusOne, cornerEndXPlusOne)));
+        __m256 c = _mm256_mul_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)&C[index])), _mm256_cvtepi32_ps(_mm256_mullo_epi32(endYPlusOne, cornerStartXPlusOne)));
+        __m256 d = _mm256_mul_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)&C[index + diameter])), _mm256_cvtepi32_ps(_mm256_mullo_epi32(endYPlusOne, cornerEndXPlusOne)));
+
+        __m256 integratedValue = _mm256_mul_ps(c_255, _mm256_sub_ps(_mm256_sub_ps(_mm256_add_ps(a, d), b), c));
+
+        // divide by area in double like AATDivideByArea
+        __m128 averageLo = _mm256_cvtpd_ps(_mm256_mul_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(integratedValue)), reciprocal));
+        __m128 averageHi = _mm256_cvtpd_ps(_mm256_mul_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(integratedValue, 1)), reciprocal));
+        __m256 average = _mm256_add_ps(half, _mm256_setr_m128(averageLo, averageHi));
+
+        __m256i averageInt = _mm256_cvttps_epi32(average);
+        __m128i lo = _mm_shuffle_epi8(_mm256_castsi256_si128(averageInt), lowBytes);
+        __m128i hi = _mm_shuffle_epi8(_mm256_extracti128_si256(averageInt, 1), lowBytes);
+        _mm_storel_epi64((__m128i*)&result[index], _mm_unpacklo_epi32(lo, hi));
+    }
+    return index;
+}
+
+#endif // AAT_X86
+
+AATHalfBoxBlurInteriorKernel GetAATHalfBoxBlurInteriorKernel()
+{
+#if AAT_X86
+    if (g_allowSIMD && GetCPUFeatures().avx2 && GetCPUFeatures().f16c)
+        return AATHalfBoxBlurInterior_AVX2_F16C;
+#endif
+    return AATHalfBoxBlurInterior_Scalar;
+}
+
+void AATHalfBoxBlurImage(const uint16* AAT, int width, int height, int radius, std::vector<uint8>& result, const BlurOptions& options)
+{
+	result.resize(width * height);
+
+	int diameter = radius * 2 + 1;
+
+	AATHalfBoxBlurInteriorKernel interiorKernel = GetAATHalfBoxBlurInteriorKernel();
+
+	BoxAreaReciprocals areas(width, height, radius);
+
+	ForEachBlurPixel(width, height, radius, options,
+		[&](int ix, int iy)
+		{
+			result[iy*width + ix] = AATHalfBoxBlurPixel(AAT, width, height, radius, ix, iy, areas.Area(ix, iy));
+		},
+		[&](int ix, int iy, int count)
+		{
+			int startX = ix - radius - 1;
+			int startY = iy - radius - 1;
+			int endY = iy + radius;
+			return interiorKernel(&AAT[startY*width + startX], &AAT[endY*width + startX], diameter, count, startX, startY, endY, areas.interior, &result[iy*width + ix]);
+		}
+	);
+}
+
+void AATHalfBoxBlurImage(const std::vector<uint16>& AAT, int width, int height, int radius, std::vector<uint8>& result, const BlurOptions& options)
+{
+	AATHalfBoxBlurImage(&AAT[0], width, height, radius, result, options);
+}
+
+void BuildSATs(const uint8* source, int width, int height, std::vector<uint32>& SAT, std::vector<int32>& SATBiased127)
+{
+    SAT.resize(width * height);
+	SATBiased127.resize(width * height);
+    for (int iy = 0; iy < height; ++iy)
+    {
+        for (int ix = 0; ix < width; ++ix)
+        {
+			size_t index = size_t(iy) * width + ix;
+
+			// make SAT
+			{
+				uint32 i_xy = uint32(source[index]);
+
+				uint32 I_xny = (ix > 0) ? SAT[index - 1] : 0;
+				uint32 I_xyn = (iy > 0) ? SAT[index - width] : 0;
+				uint32 I_xnyn = (ix > 0 && iy > 0) ? SAT[index - width - 1] : 0;
+
+				SAT[index] = i_xy + I_xny + I_xyn - I_xnyn;
+			}
+
+			// make biased SAT
+			{
+				int32 i_xy = int32(source[index]) - 127;
+
+				int32 I_xny = (ix > 0) ? SATBiased127[index - 1] : - 127;
+				int32 I_xyn = (iy > 0) ? SATBiased127[index - width] : - 127;
+				int32 I_xnyn = (ix > 0 && iy > 0) ? SATBiased127[index - width - 1] : - 127;
+
+				SATBiased127[index] = i_xy + I_xny + I_xyn - I_xnyn;
+			}
+        }
+    }
+}
+
+// Same tables as BuildSATs, but done as a prefix sum across each row followed by a prefix sum down each column.
+// Rows are independent in the first pass and columns are independent in the second, so each pass is split across threads.
+// uint32 wraps the same way in either order, and a biased SAT's -bias border works out to subtracting bias exactly once.
+// The table has CHANNELS interleaved channels, read from the first CHANNELS of every sourceStride bytes of the source.
+template <typename T, int CHANNELS>
+void BuildSATParallelInternal(const uint8* source, int sourceStride, int width, int height, T bias, T* SAT)
+{
+    ThreadPool& pool = GetThreadPool();
+
+    // row pass
+    pool.ParallelFor(height, [&](int begin, int end)
+    {
+        for (int iy = begin; iy < end; ++iy)
+        {
+            T sum[CHANNELS] = {};
+            for (int ix = 0; ix < width; ++ix)
+            {
+                for (int channel = 0; channel < CHANNELS; ++channel)
+                {
+                    sum[channel] += T(source[(iy*width + ix)*sourceStride + channel]) - bias;
+                    SAT[(iy*width + ix)*CHANNELS + channel] = sum[channel];
+                }
+            }
+        }
+    });
+
+    // column pass. Each thread owns a contiguous range of columns and walks down the rows so memory access stays linear.
+    int rowLength = width * CHANNELS;
+    pool.ParallelFor(rowLength, [&](int begin, int end)
+    {
+        for (int ix = begin; ix < end; ++ix)
+            SAT[ix] -= bias;
+
+        for (int iy = 1; iy < height; ++iy)
+        {
+            for (int ix = begin; ix < end; ++ix)
+                SAT[iy*rowLength + ix] += SAT[(iy - 1)*rowLength + ix];
+        }
+    });
+}
+
+void BuildSATParallel(const uint8* source, int width, int height, std::vector<uint32>& SAT)
+{
+    SAT.resize(width * height);
+    BuildSATParallelInternal<uint32, 1>(source, 1, width, height, 0, &SAT[0]);
+}
+
+void BuildSATBiasedParallel(const uint8* source, int width, int height, int32 bias, std::vector<int32>& SATBiased)
+{
+    SATBiased.resize(width * height);
+    BuildSATParallelInternal<int32, 1>(source, 1, width, height, bias, &SATBiased[0]);
+}
+
+void BuildSATsParallel(const uint8* source, int width, int height, std::vector<uint32>& SAT, std::vector<int32>& SATBiased127)
+{
+    BuildSATParallel(source, width, height, SAT);
+    BuildSATBiasedParallel(source, width, height, 127, SATBiased127);
+}
+
+const uint32* StreamingSATBuilder::AddRow(const uint8* sourceRow)
+{
+    // The row above's SAT values plus the running sum across this row
+    uint32 sum = 0;
+    for (int ix = 0; ix < m_width; ++ix)
+    {
+        sum += sourceRow[ix];
+        m_row[ix] += sum;
+    }
+    m_rowsAdded++;
+    return &m_row[0];
+}
+
+bool BuildSATStreaming(int width, int height, const std::function<bool(uint8* row)>& readRow, const std::function<bool(const uint32* row)>& writeRow)
+{
+    StreamingSATBuilder builder(width);
+    std::vector<uint8> sourceRow(width);
+    for (int iy = 0; iy < height; ++iy)
+    {
+        if (!readRow(&sourceRow[0]))
+            return false;
+        if (!writeRow(builder.AddRow(&sourceRow[0])))
+            return false;
+    }
+    return true;
+}
+
+void BuildTableVariant(const std::vector<uint32>& SAT, int width, int height, const TableVariant& variant, const NoiseTexture& blueNoiseTexture, uint32 whiteNoiseSeed, std::vector<uint32>& table)
+{
+    std::mt19937 rng(whiteNoiseSeed);
+    std::uniform_real_distribution<float> dist(0, 1.0f);
+
+    table.resize(width * height);
+    for (int iy = 0; iy < height; ++iy)
+    {
+        for (int ix = 0; ix < width; ++ix)
+        {
+            size_t index = size_t(iy) * width + ix;
+
+            // The rng advances for every pixel whatever the dither, so white noise values line up between variants
+            float whiteNoise = dist(rng);
+
+            float offset = 0.5f;
+            if (variant.dither == DitherKind::White)
+                offset = whiteNoise;
+            else if (variant.dither == DitherKind::Blue)
+            {
+                // tile the blue noise texture across the image to get blue noise random numbers per pixel. blue noise tiles well.
+                offset = float(blueNoiseTexture.pixels[((iy%blueNoiseTexture.height) * blueNoiseTexture.width + (ix%blueNoiseTexture.width))*blueNoiseTexture.channels])/255.0f;
+            }
+
+            double value = double(SAT[index]);
+
+            if (variant.kind == TableKind::AAT)
+            {
+                double rangeSize = double(size_t(ix + 1)*size_t(iy + 1));
+                table[index] = uint32(offset + float(variant.scale) * (value / rangeSize));
+            }
+            else
+            {
+                // NOTE: doubles can exactly represent all uint32 integers
+                table[index] = uint32(double(offset) + value / double(variant.scale));
+            }
+        }
+    }
+}
+
+BlurError CompareToGroundTruth(const std::vector<uint8>& groundTruth, const std::vector<uint8>& result)
+{
+    BlurError ret;
+    for (size_t index = 0; index < groundTruth.size(); ++index)
+    {
+        int error = std::abs(int(result[index]) - int(groundTruth[index]));
+        ret.meanAbsolute += double(error);
+        ret.rootMeanSquare += double(error * error);
+        ret.maximum = std::max(ret.maximum, error);
+    }
+    ret.meanAbsolute /= double(groundTruth.size());
+    ret.rootMeanSquare = std::sqrt(ret.rootMeanSquare / double(groundTruth.size()));
+    return ret;
+}
+
+SATTable BuildSAT(const uint8* source, int width, int height)
+{
+    SATTable ret;
+    ret.width = width;
+    ret.height = height;
+    BuildSATParallel(source, width, height, ret.values);
+    return ret;
+}
+
+AATTable BuildAAT(const SATTable& SAT, int scale, DitherKind dither, const NoiseTexture& blueNoise, uint32 whiteNoiseSeed)
+{
+    TableVariant variant = { TableKind::AAT, dither, scale, "AAT" };
+
+    AATTable ret;
+    ret.width = SAT.width;
+    ret.height = SAT.height;
+    ret.scale = scale;
+    BuildTableVariant(SAT.values, SAT.width, SAT.height, variant, blueNoise, whiteNoiseSeed, ret.values);
+    return ret;
+}
+
+// Clamps the rectangle to the image and turns it into the table corners to read. A start of -1 means that corner is 0.
+// The rectangle must not be reversed, which would give an area of 0 or less to divide by.
+inline void ClampQueryRectangle(int width, int height, int& sx, int& sy, int& ex, int& ey)
+{
+    assert(sx <= ex && sy <= ey);
+    sx = std::min(std::max(sx, 0), width - 1) - 1;
+    sy = std::min(std::max(sy, 0), height - 1) - 1;
+    ex = std::min(std::max(ex, 0), width - 1);
+    ey = std::min(std::max(ey, 0), height - 1);
+}
+
+inline float SATBoxAverage(const uint32* SAT, int width, int height, int sx, int sy, int ex, int ey)
+{
+    ClampQueryRectangle(width, height, sx, sy, ex, ey);
+
+    uint32 A = (sx >= 0 && sy >= 0) ? SAT[sy*width + sx] : 0;
+    uint32 B = (sy >= 0) ? SAT[sy*width + ex] : 0;
+    uint32 C = (sx >= 0) ? SAT[ey*width + sx] : 0;
+    uint32 D = SAT[ey*width + ex];
+
+    // wraps around correctly even if the SAT overflowed, as long as the rectangle's sum fits in 32 bits
+    uint32 sum = A + D - B - C;
+    return float(double(sum) / double((ey - sy) * (ex - sx)));
+}
+
+inline float AATBoxAverage(const uint32* AAT, int width, int height, float scale, int sx, int sy, int ex, int ey)
+{
+    ClampQueryRectangle(width, height, sx, sy, ex, ey);
+
+    // Turn each corner's average back into a sum by multiplying by its area
+    float A = (sx >= 0 && sy >= 0) ? float(AAT[sy*width + sx]) / scale * float((sy + 1) * (sx + 1)) : 0.0f;
+    float B = (sy >= 0) ? float(AAT[sy*width + ex]) / scale * float((sy + 1) * (ex + 1)) : 0.0f;
+    float C = (sx >= 0) ? float(AAT[ey*width + sx]) / scale * float((ey + 1) * (sx + 1)) : 0.0f;
+    float D = float(AAT[ey*width + ex]) / scale * float((ey + 1) * (ex + 1));
+
+    return (A + D - B - C) / float((ey - sy) * (ex - sx));
+}
+
+float QueryBoxAverage(const SATTable& SAT, int sx, int sy, int ex, int ey)
+{
+    return SATBoxAverage(&SAT.values[0], SAT.width, SAT.height, sx, sy, ex, ey);
+}
+
+float QueryBoxAverage(const AATTable& AAT, int sx, int sy, int ex, int ey)
+{
+    return AATBoxAverage(&AAT.values[0], AAT.width, AAT.height, float(AAT.scale), sx, sy, ex, ey);
+}
+
+// ------------------ Batched box queries ------------------
+
+// Bins are at least 64x64 table entries, which is 16KB of a 32 bit table
+static const int c_boxQueryBinShift = 6;
+static const int c_boxQueryMaxBins = 4096;
+
+// Evaluates count rectangles from contiguous arrays, writing averages[0..count)
+typedef void(*SATBoxQueryKernel)(const uint32* SAT, int width, int height, const int32* sx, const int32* sy, const int32* ex, const int32* ey, int count, float* averages);
+typedef void(*AATBoxQueryKernel)(const uint32* AAT, int width, int height, float scale, const int32* sx, const int32* sy, const int32* ex, const int32* ey, int count, float* averages);
+
+void SATBoxQuery_Scalar(const uint32* SAT, int width, int height, const int32* sx, const int32* sy, const int32* ex, const int32* ey, int count, float* averages)
+{
+    for (int index = 0; index < count; ++index)
+        averages[index] = SATBoxAverage(SAT, width, height, sx[index], sy[index], ex[index], ey[index]);
+}
+
+void AATBoxQuery_Scalar(const uint32* AAT, int width, int height, float scale, const int32* sx, const int32* sy, const int32* ex, const int32* ey, int count, float* averages)
+{
+    for (int index = 0; index < count; ++index)
+        averages[index] = AATBoxAverage(AAT, width, height, scale, sx[index], sy[index], ex[index], ey[index]);
+}
+
+#if AAT_X86
+// Clamps 8 rectangles and makes the gather indices and masks for their corners, the same as ClampQueryRectangle.
+// Corners with a -1 coordinate are masked off, so they read as 0 without touching memory.
+struct BoxQueryCorners8
+{
+    __m256i sx, sy, ex, ey;
+    __m256i indexA, indexB, indexC, indexD;
+    __m256i maskA, maskB, maskC;
+};
+
+TARGET_AVX2 inline BoxQueryCorners8 ClampQueryRectangles8(int width, int height, const int32* sx, const int32* sy, const int32* ex, const int32* ey)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i minusOne = _mm256_set1_epi32(-1);
+    const __m256i maxX = _mm256_set1_epi32(width - 1);
+    const __m256i maxY = _mm256_set1_epi32(height - 1);
+    const __m256i widthV = _mm256_set1_epi32(width);
+
+    BoxQueryCorners8 ret;
+    ret.sx = _mm256_add_epi32(_mm256_min_epi32(_mm256_max_epi32(_mm256_loadu_si256((const __m256i*)sx), zero), maxX), minusOne);
+    ret.sy = _mm256_add_epi32(_mm256_min_epi32(_mm256_max_epi32(_mm256_loadu_si256((const __m256i*)sy), zero), maxY), minusOne);
+    ret.ex = _mm256_min_epi32(_mm256_max_epi32(_mm256_loadu_si256((const __m256i*)ex), zero), maxX);
+    ret.ey = _mm256_min_epi32(_mm256_max_epi32(_mm256_loadu_si256((const __m256i*)ey), zero), maxY);
+
+    __m256i rowS = _mm256_mullo_epi32(ret.sy, widthV);
+    __m256i rowE = _mm256_mullo_epi32(ret.ey, widthV);
+    ret.indexA = _mm256_add_epi32(rowS, ret.sx);
+    ret.indexB = _mm256_add_epi32(rowS, ret.ex);
+    ret.indexC = _mm256_add_epi32(rowE, ret.sx);
+    ret.indexD = _mm256_add_epi32(rowE, ret.ex);
+
+    __m256i hasSX = _mm256_cmpgt_epi32(ret.sx, minusOne);
+    __m256i hasSY = _mm256_cmpgt_epi32(ret.sy, minusOne);
+    ret.maskA = _mm256_and_si256(hasSX, hasSY);
+    ret.maskB = hasSY;
+    ret.maskC = hasSX;
+    return ret;
+}
+
+TARGET_AVX2 void SATBoxQuery_AVX2(const uint32* SAT, int width, int height, const int32* sx, const int32* sy, const int32* ex, const int32* ey, int count, float* averages)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i signBit = _mm256_set1_epi32(int(0x80000000));
+    const __m256d twoToThe31 = _mm256_set1_pd(2147483648.0);
+    const int* table = (const int*)SAT;
+
+    int index = 0;
+    for (; index + 8 <= count; index += 8)
+    {
+        BoxQueryCorners8 corners = ClampQueryRectangles8(width, height, &sx[index], &sy[index], &ex[index], &ey[index]);
+
+        __m256i a = _mm256_mask_i32gather_epi32(zero, table, corners.indexA, corners.maskA, 4);
+        __m256i b = _mm256_mask_i32gather_epi32(zero, table, corners.indexB, corners.maskB, 4);
+        __m256i c = _mm256_mask_i32gather_epi32(zero, table, corners.indexC, corners.maskC, 4);
+        __m256i d = _mm256_i32gather_epi32(table, corners.indexD, 4);
+
+        __m256i sum = _mm256_sub_epi32(_mm256_sub_epi32(_mm256_add_epi32(a, d), b), c);
+        __m256i area = _mm256_mullo_epi32(_mm256_sub_epi32(corners.ey, corners.sy), _mm256_sub_epi32(corners.ex, corners.sx));
+
+        // uint32 to double by flipping the sign bit, converting as signed, and adding 2^31 back
+        __m256i biased = _mm256_xor_si256(sum, signBit);
+        __m256d sumLo = _mm256_add_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(biased)), twoToThe31);
+        __m256d sumHi = _mm256_add_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(biased, 1)), twoToThe31);
+
+        __m128 averageLo = _mm256_cvtpd_ps(_mm256_div_pd(sumLo, _mm256_cvtepi32_pd(_mm256_castsi256_si128(area))));
+        __m128 averageHi = _mm256_cvtpd_ps(_mm256_div_pd(sumHi, _mm256_cvtepi32_pd(_mm256_extracti128_si256(area, 1))));
+        _mm256_storeu_ps(&averages[index], _mm256_insertf128_ps(_mm256_castps128_ps256(averageLo), averageHi, 1));
+    }
+
+    SATBoxQuery_Scalar(SAT, width, height, &sx[index], &sy[index], &ex[index], &ey[index], count - index, &averages[index]);
+}
+
+// uint32 to float with a single rounding, like float(uint32) does. Both halves convert exactly, so only the add rounds.
+TARGET_AVX2 inline __m256 UInt32ToFloat8(__m256i value)
+{
+    __m256 hi = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(value, 16)), _mm256_set1_ps(65536.0f));
+    __m256 lo = _mm256_cvtepi32_ps(_mm256_and_si256(value, _mm256_set1_epi32(0xffff)));
+    return _mm256_add_ps(hi, lo);
+}
+
+TARGET_AVX2 void AATBoxQuery_AVX2(const uint32* AAT, int width, int height, float scale, const int32* sx, const int32* sy, const int32* ex, const int32* ey, int count, float* averages)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256 scaleV = _mm256_set1_ps(scale);
+    const int* table = (const int*)AAT;
+
+    int index = 0;
+    for (; index + 8 <= count; index += 8)
+    {
+        BoxQueryCorners8 corners = ClampQueryRectangles8(width, height, &sx[index], &sy[index], &ex[index], &ey[index]);
+
+        __m256i sx1 = _mm256_add_epi32(corners.sx, one);
+        __m256i sy1 = _mm256_add_epi32(corners.sy, one);
+        __m256i ex1 = _mm256_add_epi32(corners.ex, one);
+        __m256i ey1 = _mm256_add_epi32(corners.ey, one);
+
+        // Masked off corners gather 0, and also have an area of 0, so they come out as 0 like the scalar code
+        __m256 a = UInt32ToFloat8(_mm256_mask_i32gather_epi32(zero, table, corners.indexA, corners.maskA, 4));
+        __m256 b = UInt32ToFloat8(_mm256_mask_i32gather_epi32(zero, table, corners.indexB, corners.maskB, 4));
+        __m256 c = UInt32ToFloat8(_mm256_mask_i32gather_epi32(zero, table, corners.indexC, corners.maskC, 4));
+        __m256 d = UInt32ToFloat8(_mm256_i32gather_epi32(table, corners.indexD, 4));
+
+        a = _mm256_mul_ps(_mm256_div_ps(a, scaleV), _mm256_cvtepi32_ps(_mm256_mullo_epi32(sy1, sx1)));
+        b = _mm256_mul_ps(_mm256_div_ps(b, scaleV), _mm256_cvtepi32_ps(_mm256_mullo_epi32(sy1, ex1)));
+        c = _mm256_mul_ps(_mm256_div_ps(c, scaleV), _mm256_cvtepi32_ps(_mm256_mullo_epi32(ey1, sx1)));
+        d = _mm256_mul_ps(_mm256_div_ps(d, scaleV), _mm256_cvtepi32_ps(_mm256_mullo_epi32(ey1, ex1)));
+
+        __m256 sum = _mm256_sub_ps(_mm256_sub_ps(_mm256_add_ps(a, d), b), c);
+        __m256i area = _mm256_mullo_epi32(_mm256_sub_epi32(corners.ey, corners.sy), _mm256_sub_epi32(corners.ex, corners.sx));
+        _mm256_storeu_ps(&averages[index], _mm256_div_ps(sum, _mm256_cvtepi32_ps(area)));
+    }
+
+    AATBoxQuery_Scalar(AAT, width, height, scale, &sx[index], &sy[index], &ex[index], &ey[index], count - index, &averages[index]);
+}
+#endif // AAT_X86
+
+SATBoxQueryKernel GetSATBoxQueryKernel()
+{
+#if AAT_X86
+    if (g_allowSIMD && GetCPUFeatures().avx2)
+        return SATBoxQuery_AVX2;
+#endif
+    return SATBoxQuery_Scalar;
+}
+
+AATBoxQueryKernel GetAATBoxQueryKernel()
+{
+#if AAT_X86
+    if (g_allowSIMD && GetCPUFeatures().avx2)
+        return AATBoxQuery_AVX2;
+#endif
+    return AATBoxQuery_Scalar;
+}
+
+// Splits the boxes across threads, optionally in binned order. kernel(sx, sy, ex, ey, count, averages) evaluates contiguous arrays.
+template <typename KERNEL>
+void QueryBoxAveragesInternal(int width, int height, const BoxQueryList& boxes, float* averages, const BoxQueryOptions& options, const KERNEL& kernel)
+{
+    ThreadPool& pool = GetThreadPool();
+
+    if (!options.binForLocality || boxes.count < c_boxQueryBinMinCount)
+    {
+        pool.ParallelFor(boxes.count, [&](int begin, int end)
+        {
+            kernel(&boxes.sx[begin], &boxes.sy[begin], &boxes.ex[begin], &boxes.ey[begin], end - begin, &averages[begin]);
+        });
+        return;
+    }
+
+    // Counting sort by the bin the bottom right corner lands in. Bins are in row major order, so the top corners
+    // of neighboring boxes also tend to be near each other when boxes are similar sizes. Bins grow for big tables so
+    // there are never more than c_boxQueryMaxBins write streams open while sorting.
+    int binShift = c_boxQueryBinShift;
+    while ((((width - 1) >> binShift) + 1) * (((height - 1) >> binShift) + 1) > c_boxQueryMaxBins)
+        ++binShift;
+    int binsX = ((width - 1) >> binShift) + 1;
+    int binsY = ((height - 1) >> binShift) + 1;
+
+    auto BinOf = [&](int index)
+    {
+        int x = std::min(std::max(int(boxes.ex[index]), 0), width - 1);
+        int y = std::min(std::max(int(boxes.ey[index]), 0), height - 1);
+        return (y >> binShift) * binsX + (x >> binShift);
+    };
+
+    std::vector<int> binStarts(binsX * binsY + 1, 0);
+    for (int index = 0; index < boxes.count; ++index)
+        binStarts[BinOf(index) + 1]++;
+    for (size_t bin = 1; bin < binStarts.size(); ++bin)
+        binStarts[bin] += binStarts[bin - 1];
+
+    // Copy the boxes into sorted order. Reads are linear and each bin is written linearly, so this streams through memory
+    // rather than paying a cache miss per box like reading the boxes in sorted order would.
+    std::vector<int32> sorted(size_t(boxes.count) * 5);
+    int32* sortedSX = &sorted[0];
+    int32* sortedSY = sortedSX + boxes.count;
+    int32* sortedEX = sortedSY + boxes.count;
+    int32* sortedEY = sortedEX + boxes.count;
+    int32* sortedIndex = sortedEY + boxes.count;
+    for (int index = 0; index < boxes.count; ++index)
+    {
+        int position = binStarts[BinOf(index)]++;
+        sortedSX[position] = boxes.sx[index];
+        sortedSY[position] = boxes.sy[index];
+        sortedEX[position] = boxes.ex[index];
+        sortedEY[position] = boxes.ey[index];
+        sortedIndex[position] = index;
+    }
+
+    // Evaluate in sorted order a block at a time, and scatter the results back to where they go
+    pool.ParallelFor(boxes.count, [&](int begin, int end)
+    {
+        static const int c_blockSize = 256;
+        float blockAverages[c_blockSize];
+
+        for (int blockBegin = begin; blockBegin < end; blockBegin += c_blockSize)
+        {
+            int blockCount = std::min(c_blockSize, end - blockBegin);
+            kernel(&sortedSX[blockBegin], &sortedSY[blockBegin], &sortedEX[blockBegin], &sortedEY[blockBegin], blockCount, blockAverages);
+            for (int index = 0; index < blockCount; ++index)
+                averages[sortedIndex[blockBegin + index]] = blockAverages[index];
+        }
+    });
+}
+
+void QueryBoxAverages(const SATTable& SAT, const BoxQueryList& boxes, float* averages, const BoxQueryOptions& options)
+{
+    SATBoxQueryKernel kernel = GetSATBoxQueryKernel();
+    const uint32* table = &SAT.values[0];
+    QueryBoxAveragesInternal(SAT.width, SAT.height, boxes, averages, options,
+        [&](const int32* sx, const int32* sy, const int32* ex, const int32* ey, int count, float* result)
+        {
+            kernel(table, SAT.width, SAT.height, sx, sy, ex, ey, count, result);
+        }
+    );
+}
+
+void QueryBoxAverages(const AATTable& AAT, const BoxQueryList& boxes, float* averages, const BoxQueryOptions& options)
+{
+    AATBoxQueryKernel kernel = GetAATBoxQueryKernel();
+    const uint32* table = &AAT.values[0];
+    float scale = float(AAT.scale);
+    QueryBoxAveragesInternal(AAT.width, AAT.height, boxes, averages, options,
+        [&](const int32* sx, const int32* sy, const int32* ex, const int32* ey, int count, float* result)
+        {
+            kernel(table, AAT.width, AAT.height, scale, sx, sy, ex, ey, count, result);
+        }
+    );
+}
+
+// ------------------ Variable radius blurs ------------------
+
+// Turns a row of a radius map into each pixel's whole radius, and for float maps how far it is towards the next
+// radius up. Radiuses are clamped to [0, maxRadius].
+void VariableRadiusRow(const uint8* radiusMap, int width, int iy, int maxRadius, int32* radiuses, float*)
+{
+    const uint8* row = &radiusMap[iy*width];
+    for (int ix = 0; ix < width; ++ix)
+        radiuses[ix] = std::min(int(row[ix]), maxRadius);
+}
+
+void VariableRadiusRow(const float* radiusMap, int width, int iy, int maxRadius, int32* radiuses, float* fractions)
+{
+    const float* row = &radiusMap[iy*width];
+    for (int ix = 0; ix < width; ++ix)
+    {
+        // written so that NaN comes out as 0
+        float radius = (row[ix] > 0.0f) ? std::min(row[ix], float(maxRadius)) : 0.0f;
+        radiuses[ix] = int(radius);
+        fractions[ix] = radius - float(radiuses[ix]);
+    }
+}
+
+// Runs of at least this many pixels with the same radius are blurred in place rather than bucketed
+static const int c_variableRadiusMinRun = 8;
+
+// Drives the variable radius blurs a row at a time. A pixel of radius r reads table rows iy - r - 1 and iy + r.
+// * Radius maps are mostly runs of the same radius, and a long run reads neighboring entries of two table rows like a
+//   fixed radius blur does, so it is done as a group on its own.
+// * The pixels of short runs, where the radius changes every few pixels, are counting sorted by radius, so a bucket's
+//   pixels all read the same two table rows, left to right. Going across the row in x order would instead jump
+//   between table rows on every pixel, and the gathers of neighboring pixels would not share cache lines.
+// The pixels of a group whose boxes need no clamping are a contiguous range of its sorted columns, which go through
+// interior(radius, iy, xs, count, fractions), and the rest go through border(radius, ix, iy, fraction) like
+// ForEachBlurPixel. extraRadius is how much bigger than its radius the largest box a pixel reads is, which is 1 for
+// float maps. A radius of max(width, height) covers the whole image from any pixel, so radiuses are clamped to that.
+template <typename T, typename BORDER, typename INTERIOR>
+void ForEachBlurPixelVariableRadius(int width, int height, const T* radiusMap, int extraRadius, const BORDER& border, const INTERIOR& interior)
+{
+    int maxRadius = std::max(width, height);
+
+    std::vector<int32> radiuses(width);
+    std::vector<float> fractions(width, 0.0f);
+    std::vector<int32> order(width);
+    std::vector<int32> shortColumns(width);
+    std::vector<int32> bucketStarts(maxRadius + 2, 0);
+
+    auto DoGroup = [&](int radius, int iy, int index, int end)
+    {
+        int boxRadius = radius + extraRadius;
+        if (iy - boxRadius - 1 >= 0 && iy + boxRadius <= height - 1)
+        {
+            int interiorStart = int(std::lower_bound(&order[index], &order[0] + end, boxRadius + 1) - &order[0]);
+            int interiorEnd = int(std::upper_bound(&order[interiorStart], &order[0] + end, width - 1 - boxRadius) - &order[0]);
+
+            for (; index < interiorStart; ++index)
+                border(radius, order[index], iy, fractions[order[index]]);
+
+            index += interior(radius, iy, &order[index], interiorEnd - index, &fractions[0]);
+        }
+
+        for (; index < end; ++index)
+            border(radius, order[index], iy, fractions[order[index]]);
+    };
+
+    for (int iy = 0; iy < height; ++iy)
+    {
+        VariableRadiusRow(radiusMap, width, iy, maxRadius, &radiuses[0], &fractions[0]);
+
+        // Long runs are done as they are found, and the pixels of short runs are counted into bucketStarts[radius + 1]
+        int numShort = 0;
+        int minRadius = maxRadius;
+        int maxShortRadius = 0;
+        for (int runStart = 0; runStart < width;)
+        {
+            int radius = radiuses[runStart];
+            int runEnd = runStart + 1;
+            while (runEnd < width && radiuses[runEnd] == radius)
+                ++runEnd;
+
+            if (runEnd - runStart >= c_variableRadiusMinRun)
+            {
+                for (int ix = runStart; ix < runEnd; ++ix)
+                    order[ix] = ix;
+                DoGroup(radius, iy, runStart, runEnd);
+            }
+            else
+            {
+                minRadius = std::min(minRadius, radius);
+                maxShortRadius = std::max(maxShortRadius, radius);
+                bucketStarts[radius + 1] += runEnd - runStart;
+                for (int ix = runStart; ix < runEnd; ++ix)
+                    shortColumns[numShort++] = ix;
+            }
+            runStart = runEnd;
+        }
+
+        if (numShort == 0)
+            continue;
+
+        // Sort the short run pixels into order by radius, and by x within a radius. bucketStarts[radius] is used as the
+        // next free slot of its bucket, which leaves it at the end of the bucket afterwards.
+        for (int radius = minRadius; radius <= maxShortRadius; ++radius)
+            bucketStarts[radius + 1] += bucketStarts[radius];
+        for (int index = 0; index < numShort; ++index)
+        {
+            int ix = shortColumns[index];
+            order[bucketStarts[radiuses[ix]]++] = ix;
+        }
+
+        int index = 0;
+        for (int radius = minRadius; radius <= maxShortRadius; ++radius)
+        {
+            int end = bucketStarts[radius];
+            if (index != end)
+                DoGroup(radius, iy, index, end);
+            index = end;
+        }
+
+        std::fill(&bucketStarts[minRadius], &bucketStarts[maxShortRadius + 2], 0);
+    }
+}
+
+// The area of a pixel's box, clamped to the image
+inline int ClampedBoxArea(int width, int height, int radius, int ix, int iy)
+{
+    int boxWidth = std::min(ix + radius, width - 1) - std::max(ix - radius - 1, -1);
+    int boxHeight = std::min(iy + radius, height - 1) - std::max(iy - radius - 1, -1);
+    return boxWidth * boxHeight;
+}
+
+// The sum of a pixel's box, clamped to the image, from a 32 bit SAT
+inline uint32 SATBoxSum(const uint32* SAT, int width, int height, int radius, int ix, int iy)
+{
+	int startX = std::max(ix - radius - 1, -1);
+	int startY = std::max(iy - radius - 1, -1);
+
+	int endX = std::min(ix + radius, width - 1);
+	int endY = std::min(iy + radius, height - 1);
+
+	uint32 A = (startX >= 0 && startY >= 0) ? SAT[startY*width + startX] : 0;
+	uint32 B = (startY >= 0) ? SAT[startY*width + endX] : 0;
+	uint32 C = (startX >= 0) ? SAT[endY*width + startX] : 0;
+	uint32 D = SAT[endY*width + endX];
+
+	return A + D - B - C;
+}
+
+// Blends the averages of a pixel's two boxes and rounds, for float radius maps. A fraction of 0 gives exactly what the
+// whole radius would.
+inline uint8 BlendBoxAverages(double average0, double average1, float fraction)
+{
+	return uint8(average0 + double(fraction) * (average1 - average0) + (0.5 + c_reciprocalRoundingNudge));
+}
+
+inline uint8 BlendBoxAverages(float average0, float average1, float fraction)
+{
+	return uint8(average0 + fraction * (average1 - average0) + 0.5f);
+}
+
+// Interior kernels for the variable radius blurs. xs are the columns of count pixels of row iy which all have this
+// radius, and need no clamping. The corners of each are read from the table and its result is written to
+// resultRow[x]. Returns how many pixels were written, which may be less than count.
+typedef int(*SATBoxBlurGatherKernel)(const uint32* SAT, int width, int iy, const int32* xs, int count, int radius, double reciprocalArea, uint8* resultRow);
+typedef int(*AATBoxBlurGatherKernel)(const uint32* AAT, int width, int iy, const int32* xs, int count, int radius, int scale, double reciprocalArea, uint8* resultRow);
+
+// The same for float radius maps, which blend each pixel's box with the box one radius bigger by fractions[x]
+typedef int(*SATBoxBlurGatherBlendKernel)(const uint32* SAT, int width, int iy, const int32* xs, const float* fractions, int count, int radius, double reciprocalArea0, double reciprocalArea1, uint8* resultRow);
+typedef int(*AATBoxBlurGatherBlendKernel)(const uint32* AAT, int width, int iy, const int32* xs, const float* fractions, int count, int radius, int scale, double reciprocalArea0, double reciprocalArea1, uint8* resultRow);
+
+inline uint32 SATBoxSumUnclamped(const uint32* SAT, int width, int iy, int ix, int radius)
+{
+    const uint32* A = &SAT[(iy - radius - 1)*width];
+    const uint32* C = &SAT[(iy + radius)*width];
+    return A[ix - radius - 1] + C[ix + radius] - A[ix + radius] - C[ix - radius - 1];
+}
+
+// Same math as AATBoxBlurInterior
+inline float AATBoxBlurValueUnclamped(const uint32* AAT, int width, int iy, int ix, int radius, float divisor, double reciprocalArea)
+{
+    int startX = ix - radius - 1;
+    int startY = iy - radius - 1;
+    int endX = ix + radius;
+    int endY = iy + radius;
+
+    float a = float(AAT[startY*width + startX]) / divisor;
+    a *= float((startY + 1)*(startX + 1));
+
+    float b = float(AAT[startY*width + endX]) / divisor;
+    b *= float((startY + 1)*(endX + 1));
+
+    float c = float(AAT[endY*width + startX]) / divisor;
+    c *= float((endY + 1)*(startX + 1));
+
+    float d = float(AAT[endY*width + endX]) / divisor;
+    d *= float((endY + 1)*(endX + 1));
+
+    float integratedValue = a + d - b - c;
+
+    return AATDivideByArea(255.0f * integratedValue, reciprocalArea);
+}
+
+int SATBoxBlurGather_Scalar(const uint32* SAT, int width, int iy, const int32* xs, int count, int radius, double reciprocalArea, uint8* resultRow)
+{
+    for (int index = 0; index < count; ++index)
+        resultRow[xs[index]] = uint8(0.5 + c_reciprocalRoundingNudge + double(SATBoxSumUnclamped(SAT, width, iy, xs[index], radius)) * reciprocalArea);
+    return count;
+}
+
+int SATBoxBlurGatherBlend_Scalar(const uint32* SAT, int width, int iy, const int32* xs, const float* fractions, int count, int radius, double reciprocalArea0, double reciprocalArea1, uint8* resultRow)
+{
+    for (int index = 0; index < count; ++index)
+    {
+        int ix = xs[index];
+        double average0 = double(SATBoxSumUnclamped(SAT, width, iy, ix, radius)) * reciprocalArea0;
+        double average1 = double(SATBoxSumUnclamped(SAT, width, iy, ix, radius + 1)) * reciprocalArea1;
+        resultRow[ix] = BlendBoxAverages(average0, average1, fractions[ix]);
+    }
+    return count;
+}
+
+int AATBoxBlurGather_Scalar(const uint32* AAT, int width, int iy, const int32* xs, int count, int radius, int scale, double reciprocalArea, uint8* resultRow)
+{
+    float divisor = float(256 * scale);
+    for (int index = 0; index < count; ++index)
+        resultRow[xs[index]] = uint8(0.5f + AATBoxBlurValueUnclamped(AAT, width, iy, xs[index], radius, divisor, reciprocalArea));
+    return count;
+}
+
+int AATBoxBlurGatherBlend_Scalar(const uint32* AAT, int width, int iy, const int32* xs, const float* fractions, int count, int radius, int scale, double reciprocalArea0, double reciprocalArea1, uint8* resultRow)
+{
+    float divisor = float(256 * scale);
+    for (int index = 0; index < count; ++index)
+    {
+        int ix = xs[index];
+        float value0 = AATBoxBlurValueUnclamped(AAT, width, iy, ix, radius, divisor, reciprocalArea0);
+        float value1 = AATBoxBlurValueUnclamped(AAT, width, iy, ix, radius + 1, divisor, reciprocalArea1);
+        resultRow[ix] = BlendBoxAverages(value0, value1, fractions[ix]);
+    }
+    return count;
+}
+
+#if AAT_X86
+
+// xs are sorted and distinct, so 8 of them are neighboring columns when the last is 7 more than the first. Those
+// are loaded and stored with plain loads and stores instead of gathers.
+inline bool Contiguous8(const int32* xs)
+{
+    return xs[7] - xs[0] == 7;
+}
+
+// Loads the corners of 8 pixels from table row, gathering them if they aren't contiguous
+TARGET_AVX2 inline __m256i LoadCorners8(const uint32* row, const int32* xs, __m256i columns, int offset, bool contiguous)
+{
+    if (contiguous)
+        return _mm256_loadu_si256((const __m256i*)&row[xs[0] + offset]);
+    return _mm256_i32gather_epi32((const int*)row, _mm256_add_epi32(columns, _mm256_set1_epi32(offset)), 4);
+}
+
+// Box sums of 8 pixels of one radius with the same wrapping uint32 math as SATBoxSumUnclamped
+TARGET_AVX2 inline __m256i SATBoxSum8(const uint32* SAT, int width, int iy, const int32* xs, __m256i x, bool contiguous, int radius)
+{
+    const uint32* A = &SAT[(iy - radius - 1)*width];
+    const uint32* C = &SAT[(iy + radius)*width];
+
+    __m256i a = LoadCorners8(A, xs, x, -radius - 1, contiguous);
+    __m256i b = LoadCorners8(A, xs, x, radius, contiguous);
+    __m256i c = LoadCorners8(C, xs, x, -radius - 1, contiguous);
+    __m256i d = LoadCorners8(C, xs, x, radius, contiguous);
+    return _mm256_sub_epi32(_mm256_sub_epi32(_mm256_add_epi32(a, d), b), c);
+}
+
+// uint32 to double as two halves, flipping the sign bit to convert as signed and adding 2^31 back
+TARGET_AVX2 inline void UInt32ToDouble8(__m256i value, __m256d& lo, __m256d& hi)
+{
+    const __m256d twoToThe31 = _mm256_set1_pd(2147483648.0);
+    __m256i biased = _mm256_xor_si256(value, _mm256_set1_epi32(int(0x80000000)));
+    lo = _mm256_add_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(biased)), twoToThe31);
+    hi = _mm256_add_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(biased, 1)), twoToThe31);
+}
+
+// Writes the low byte of each of 8 int32s to resultRow at the 8 columns in xs. There is no scatter in AVX2.
+TARGET_AVX2 inline void StoreBytes8(__m256i values, const int32* xs, bool contiguous, uint8* resultRow)
+{
+    const __m256i lowBytes = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    __m256i bytes = _mm256_shuffle_epi8(values, lowBytes);
+    __m128i packed = _mm_unpacklo_epi32(_mm256_castsi256_si128(bytes), _mm256_extracti128_si256(bytes, 1));
+
+    if (contiguous)
+    {
+        _mm_storel_epi64((__m128i*)&resultRow[xs[0]], packed);
+        return;
+    }
+
+    alignas(16) uint8 scattered[16];
+    _mm_store_si128((__m128i*)scattered, packed);
+    for (int index = 0; index < 8; ++index)
+        resultRow[xs[index]] = scattered[index];
+}
+
+TARGET_AVX2 int SATBoxBlurGather_AVX2(const uint32* SAT, int width, int iy, const int32* xs, int count, int radius, double reciprocalArea, uint8* resultRow)
+{
+    const __m256d reciprocal = _mm256_set1_pd(reciprocalArea);
+    const __m256d half = _mm256_set1_pd(0.5 + c_reciprocalRoundingNudge);
+
+    int index = 0;
+    for (; index + 8 <= count; index += 8)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i*)&xs[index]);
+        bool contiguous = Contiguous8(&xs[index]);
+
+        __m256d lo, hi;
+        UInt32ToDouble8(SATBoxSum8(SAT, width, iy, &xs[index], x, contiguous, radius), lo, hi);
+
+        __m128i loInt = _mm256_cvttpd_epi32(_mm256_add_pd(_mm256_mul_pd(lo, reciprocal), half));
+        __m128i hiInt = _mm256_cvttpd_epi32(_mm256_add_pd(_mm256_mul_pd(hi, reciprocal), half));
+        StoreBytes8(_mm256_setr_m128i(loInt, hiInt), &xs[index], contiguous, resultRow);
+    }
+    return index;
+}
+
+TARGET_AVX2 int SATBoxBlurGatherBlend_AVX2(const uint32* SAT, int width, int iy, const int32* xs, const float* fractions, int count, int radius, double reciprocalArea0, double reciprocalArea1, uint8* resultRow)
+{
+    const __m256d reciprocal0 = _mm256_set1_pd(reciprocalArea0);
+    const __m256d reciprocal1 = _mm256_set1_pd(reciprocalArea1);
+    const __m256d half = _mm256_set1_pd(0.5 + c_reciprocalRoundingNudge);
+
+    int index = 0;
+    for (; index + 8 <= count; index += 8)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i*)&xs[index]);
+        bool contiguous = Contiguous8(&xs[index]);
+        __m256 fraction = contiguous ? _mm256_loadu_ps(&fractions[xs[index]]) : _mm256_i32gather_ps(fractions, x, 4);
+        __m256d fractionLo = _mm256_cvtps_pd(_mm256_castps256_ps128(fraction));
+        __m256d fractionHi = _mm256_cvtps_pd(_mm256_extractf128_ps(fraction, 1));
+
+        __m256d lo0, hi0, lo1, hi1;
+        UInt32ToDouble8(SATBoxSum8(SAT, width, iy, &xs[index], x, contiguous, radius), lo0, hi0);
+        UInt32ToDouble8(SATBoxSum8(SAT, width, iy, &xs[index], x, contiguous, radius + 1), lo1, hi1);
+        lo0 = _mm256_mul_pd(lo0, reciprocal0);
+        hi0 = _mm256_mul_pd(hi0, reciprocal0);
+        lo1 = _mm256_mul_pd(lo1, reciprocal1);
+        hi1 = _mm256_mul_pd(hi1, reciprocal1);
+
+        // same order as BlendBoxAverages
+        __m256d lo = _mm256_add_pd(_mm256_add_pd(lo0, _mm256_mul_pd(fractionLo, _mm256_sub_pd(lo1, lo0))), half);
+        __m256d hi = _mm256_add_pd(_mm256_add_pd(hi0, _mm256_mul_pd(fractionHi, _mm256_sub_pd(hi1, hi0))), half);
+        StoreBytes8(_mm256_setr_m128i(_mm256_cvttpd_epi32(lo), _mm256_cvttpd_epi32(hi)), &xs[index], contiguous, resultRow);
+    }
+    return index;
+}
+
+// Same math as AATBoxBlurValueUnclamped for 8 pixels of one radius. AAT values are far below 2^31, so converting them
+// as signed ints rounds the same as float(uint32). The divide by area is done in double like AATDivideByArea.
+TARGET_AVX2 inline __m256 AATBoxBlurValue8(const uint32* AAT, int width, int iy, const int32* xs, __m256i x, bool contiguous, int radius, __m256 divisor, __m256d reciprocalArea)
+{
+    int startY = iy - radius - 1;
+    int endY = iy + radius;
+    const uint32* A = &AAT[startY*width];
+    const uint32* C = &AAT[endY*width];
+    __m256i startX = _mm256_sub_epi32(x, _mm256_set1_epi32(radius + 1));
+    __m256i endX = _mm256_add_epi32(x, _mm256_set1_epi32(radius));
+
+    const __m256i one = _mm256_set1_epi32(1);
+    __m256i startX1 = _mm256_add_epi32(startX, one);
+    __m256i endX1 = _mm256_add_epi32(endX, one);
+    __m256i startY1 = _mm256_set1_epi32(startY + 1);
+    __m256i endY1 = _mm256_set1_epi32(endY + 1);
+
+    __m256 a = _mm256_div_ps(_mm256_cvtepi32_ps(LoadCorners8(A, xs, x, -radius - 1, contiguous)), divisor);
+    __m256 b = _mm256_div_ps(_mm256_cvtepi32_ps(LoadCorners8(A, xs, x, radius, contiguous)), divisor);
+    __m256 c = _mm256_div_ps(_mm256_cvtepi32_ps(LoadCorners8(C, xs, x, -radius - 1, contiguous)), divisor);
+    __m256 d = _mm256_div_ps(_mm256_cvtepi32_ps(LoadCorners8(C, xs, x, radius, contiguous)), divisor);
+
+    a = _mm256_mul_ps(a, _mm256_cvtepi32_ps(_mm256_mullo_epi32(startY1, startX1)));
+    b = _mm256_mul_ps(b, _mm256_cvtepi32_ps(_mm256_mullo_epi32(startY1, endX1)));
+    c = _mm256_mul_ps(c, _mm256_cvtepi32_ps(_mm256_mullo_epi32(endY1, startX1)));
+    d = _mm256_mul_ps(d, _mm256_cvtepi32_ps(_mm256_mullo_epi32(endY1, endX1)));
+
+    __m256 integratedValue = _mm256_mul_ps(_mm256_set1_ps(255.0f), _mm256_sub_ps(_mm256_sub_ps(_mm256_add_ps(a, d), b), c));
+
+    __m128 lo = _mm256_cvtpd_ps(_mm256_mul_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(integratedValue)), reciprocalArea));
+    __m128 hi = _mm256_cvtpd_ps(_mm256_mul_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(integratedValue, 1)), reciprocalArea));
+    return _mm256_setr_m128(lo, hi);
+}
+
+TARGET_AVX2 int AATBoxBlurGather_AVX2(const uint32* AAT, int width, int iy, const int32* xs, int count, int radius, int scale, double reciprocalArea, uint8* resultRow)
+{
+    const __m256 divisor = _mm256_set1_ps(float(256 * scale));
+    const __m256d reciprocal = _mm256_set1_pd(reciprocalArea);
+    const __m256 half = _mm256_set1_ps(0.5f);
+
+    int index = 0;
+    for (; index + 8 <= count; index += 8)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i*)&xs[index]);
+        bool contiguous = Contiguous8(&xs[index]);
+        __m256 value = AATBoxBlurValue8(AAT, width, iy, &xs[index], x, contiguous, radius, divisor, reciprocal);
+        StoreBytes8(_mm256_cvttps_epi32(_mm256_add_ps(half, value)), &xs[index], contiguous, resultRow);
+    }
+    return index;
+}
+
+TARGET_AVX2 int AATBoxBlurGatherBlend_AVX2(const uint32* AAT, int width, int iy, const int32* xs, const float* fractions, int count, int radius, int scale, double reciprocalArea0, double reciprocalArea1, uint8* resultRow)
+{
+    const __m256 divisor = _mm256_set1_ps(float(256 * scale));
+    const __m256d reciprocal0 = _mm256_set1_pd(reciprocalArea0);
+    const __m256d reciprocal1 = _mm256_set1_pd(reciprocalArea1);
+    const __m256 half = _mm256_set1_ps(0.5f);
+
+    int index = 0;
+    for (; index + 8 <= count; index += 8)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i*)&xs[index]);
+        bool contiguous = Contiguous8(&xs[index]);
+        __m256 fraction = contiguous ? _mm256_loadu_ps(&fractions[xs[index]]) : _mm256_i32gather_ps(fractions, x, 4);
+        __m256 value0 = AATBoxBlurValue8(AAT, width, iy, &xs[index], x, contiguous, radius, divisor, reciprocal0);
+        __m256 value1 = AATBoxBlurValue8(AAT, width, iy, &xs[index], x, contiguous, radius + 1, divisor, reciprocal1);
+
+        // same order as BlendBoxAverages
+        __m256 value = _mm256_add_ps(_mm256_add_ps(value0, _mm256_mul_ps(fraction, _mm256_sub_ps(value1, value0))), half);
+        StoreBytes8(_mm256_cvttps_epi32(value), &xs[index], contiguous, resultRow);
+    }
+    return index;
+}
+
+#endif // AAT_X86
+
+SATBoxBlurGatherKernel GetSATBoxBlurGatherKernel()
+{
+#if AAT_X86
+    if (g_allowSIMD && GetCPUFeatures().avx2)
+        return SATBoxBlurGather_AVX2;
+#endif
+    return SATBoxBlurGather_Scalar;
+}
+
+SATBoxBlurGatherBlendKernel GetSATBoxBlurGatherBlendKernel()
+{
+#if AAT_X86
+    if (g_allowSIMD && GetCPUFeatures().avx2)
+        return SATBoxBlurGatherBlend_AVX2;
+#endif
+    return SATBoxBlurGatherBlend_Scalar;
+}
+
+AATBoxBlurGatherKernel GetAATBoxBlurGatherKernel()
+{
+#if AAT_X86
+    if (g_allowSIMD && GetCPUFeatures().avx2)
+        return AATBoxBlurGather_AVX2;
+#endif
+    return AATBoxBlurGather_Scalar;
+}
+
+AATBoxBlurGatherBlendKernel GetAATBoxBlurGatherBlendKernel()
+{
+#if AAT_X86
+    if (g_allowSIMD && GetCPUFeatures().avx2)
+        return AATBoxBlurGatherBlend_AVX2;
+#endif
+    return AATBoxBlurGatherBlend_Scalar;
+}
+
+// 1 / (diameter * diameter) for the interior pixels of each radius a row might use
+void MakeInteriorAreaReciprocals(int width, int height, std::vector<double>& reciprocals)
+{
+    reciprocals.resize(std::max(width, height) + 2);
+    for (size_t radius = 0; radius < reciprocals.size(); ++radius)
+    {
+        double diameter = double(radius * 2 + 1);
+        reciprocals[radius] = 1.0 / (diameter * diameter);
+    }
+}
+
+void SATBoxBlurImageVariableRadius(const uint32* SAT, int width, int height, const uint8* radiusMap, std::vector<uint8>& result)
+{
+	result.resize(width * height);
+
+	SATBoxBlurGatherKernel interiorKernel = GetSATBoxBlurGatherKernel();
+
+	std::vector<double> interiorAreas;
+	MakeInteriorAreaReciprocals(width, height, interiorAreas);
+
+	ForEachBlurPixelVariableRadius(width, height, radiusMap, 0,
+		[&](int radius, int ix, int iy, float)
+		{
+			double reciprocalArea = 1.0 / double(ClampedBoxArea(width, height, radius, ix, iy));
+			result[iy*width + ix] = SATBoxBlurPixel(SAT, width, height, radius, ix, iy, 1, uint32(-1), reciprocalArea);
+		},
+		[&](int radius, int iy, const int32* xs, int count, const float*)
+		{
+			return interiorKernel(SAT, width, iy, xs, count, radius, interiorAreas[radius], &result[iy*width]);
+		}
+	);
+}
+
+void SATBoxBlurImageVariableRadius(const uint32* SAT, int width, int height, const float* radiusMap, std::vector<uint8>& result)
+{
+	result.resize(width * height);
+
+	SATBoxBlurGatherBlendKernel interiorKernel = GetSATBoxBlurGatherBlendKernel();
+
+	std::vector<double> interiorAreas;
+	MakeInteriorAreaReciprocals(width, height, interiorAreas);
+
+	ForEachBlurPixelVariableRadius(width, height, radiusMap, 1,
+		[&](int radius, int ix, int iy, float fraction)
+		{
+			double average0 = double(SATBoxSum(SAT, width, height, radius, ix, iy)) * (1.0 / double(ClampedBoxArea(width, height, radius, ix, iy)));
+			double average1 = double(SATBoxSum(SAT, width, height, radius + 1, ix, iy)) * (1.0 / double(ClampedBoxArea(width, height, radius + 1, ix, iy)));
+			result[iy*width + ix] = BlendBoxAverages(average0, average1, fraction);
+		},
+		[&](int radius, int iy, const int32* xs, int count, const float* fractions)
+		{
+			return interiorKernel(SAT, width, iy, xs, fractions, count, radius, interiorAreas[radius], interiorAreas[radius + 1], &result[iy*width]);
+		}
+	);
+}
+
+void AATBoxBlurImageVariableRadius(const uint32* AAT, int width, int height, const uint8* radiusMap, int scale, std::vector<uint8>& result)
+{
+	result.resize(width * height);
+
+	AATBoxBlurGatherKernel interiorKernel = GetAATBoxBlurGatherKernel();
+
+	std::vector<double> interiorAreas;
+	MakeInteriorAreaReciprocals(width, height, interiorAreas);
+
+	ForEachBlurPixelVariableRadius(width, height, radiusMap, 0,
+		[&](int radius, int ix, int iy, float)
+		{
+			double reciprocalArea = 1.0 / double(ClampedBoxArea(width, height, radius, ix, iy));
+			result[iy*width + ix] = AATBoxBlurPixel(AAT, width, height, radius, ix, iy, scale, reciprocalArea);
+		},
+		[&](int radius, int iy, const int32* xs, int count, const float*)
+		{
+			return interiorKernel(AAT, width, iy, xs, count, radius, scale, interiorAreas[radius], &result[iy*width]);
+		}
+	);
+}
+
+void AATBoxBlurImageVariableRadius(const uint32* AAT, int width, int height, const float* radiusMap, int scale, std::vector<uint8>& result)
+{
+	result.resize(width * height);
+
+	AATBoxBlurGatherBlendKernel interiorKernel = GetAATBoxBlurGatherBlendKernel();
+
+	std::vector<double> interiorAreas;
+	MakeInteriorAreaReciprocals(width, height, interiorAreas);
+
+	ForEachBlurPixelVariableRadius(width, height, radiusMap, 1,
+		[&](int radius, int ix, int iy, float fraction)
+		{
+			float value0 = AATBoxBlurValue(AAT, width, height, radius, ix, iy, scale, 1.0 / double(ClampedBoxArea(width, height, radius, ix, iy)));
+			float value1 = AATBoxBlurValue(AAT, width, height, radius + 1, ix, iy, scale, 1.0 / double(ClampedBoxArea(width, height, radius + 1, ix, iy)));
+			result[iy*width + ix] = BlendBoxAverages(value0, value1, fraction);
+		},
+		[&](int radius, int iy, const int32* xs, int count, const float* fractions)
+		{
+			return interiorKernel(AAT, width, iy, xs, fractions, count, radius, scale, interiorAreas[radius], interiorAreas[radius + 1], &result[iy*width]);
+		}
+	);
+}
+
+void SATBoxBlurImageVariableRadius(const std::vector<uint32>& SAT, int width, int height, const uint8* radiusMap, std::vector<uint8>& result)
+{
+	SATBoxBlurImageVariableRadius(&SAT[0], width, height, radiusMap, result);
+}
+
+void SATBoxBlurImageVariableRadius(const std::vector<uint32>& SAT, int width, int height, const float* radiusMap, std::vector<uint8>& result)
+{
+	SATBoxBlurImageVariableRadius(&SAT[0], width, height, radiusMap, result);
+}
+
+void AATBoxBlurImageVariableRadius(const std::vector<uint32>& AAT, int width, int height, const uint8* radiusMap, int scale, std::vector<uint8>& result)
+{
+	AATBoxBlurImageVariableRadius(&AAT[0], width, height, radiusMap, scale, result);
+}
+
+void AATBoxBlurImageVariableRadius(const std::vector<uint32>& AAT, int width, int height, const float* radiusMap, int scale, std::vector<uint8>& result)
+{
+	AATBoxBlurImageVariableRadius(&AAT[0], width, height, radiusMap, scale, result);
+}
+
+// ------------------ Wrap around SATs ------------------
+
+int WrapAroundSATBits(int maxFilterWidth, int maxFilterHeight)
+{
+    // the largest box sum has to be representable, so 255 * w * h + 1 values
+    uint64_t numValues = uint64_t(255) * uint64_t(maxFilterWidth) * uint64_t(maxFilterHeight) + 1;
+    int numBits = 1;
+    while ((uint64_t(1) << numBits) < numValues)
+        numBits++;
+    return numBits;
+}
+
+bool BuildWrapAroundSAT(const uint8* source, int width, int height, int maxFilterWidth, int maxFilterHeight, WrapAroundSAT& table)
+{
+    table.width = width;
+    table.height = height;
+    table.maxFilterWidth = maxFilterWidth;
+    table.maxFilterHeight = maxFilterHeight;
+    table.numBits = WrapAroundSATBits(maxFilterWidth, maxFilterHeight);
+
+    // uint16 prefix sums wrap at 2^16 as they go, which keeps the same low bits as building at 32 bits and truncating
+    table.values16.clear();
+    table.values32.clear();
+    if (table.numBits > 32)
+        return false;
+
+    if (table.numBits <= 16)
+    {
+        table.values16.resize(width * height);
+        BuildSATParallelInternal<uint16, 1>(source, 1, width, height, 0, &table.values16[0]);
+    }
+    else
+    {
+        table.values32.resize(width * height);
+        BuildSATParallelInternal<uint32, 1>(source, 1, width, height, 0, &table.values32[0]);
+    }
+    return true;
+}
+
+bool WrapAroundSATBoxBlurImage(const WrapAroundSAT& table, int radius, std::vector<uint8>& result, const BlurOptions& options)
+{
+    if (radius * 2 + 1 > table.maxFilterWidth || radius * 2 + 1 > table.maxFilterHeight)
+    {
+        result.clear();
+        return false;
+    }
+
+    if (table.numBits <= 16)
+        SATBoxBlurImage(&table.values16[0], table.width, table.height, radius, 1, table.numBits, result, options);
+    else
+        SATBoxBlurImage(&table.values32[0], table.width, table.height, radius, 1, table.numBits, result, options);
+    return true;
+}
+
+float QueryBoxAverage(const WrapAroundSAT& table, int sx, int sy, int ex, int ey)
+{
+    ClampQueryRectangle(table.width, table.height, sx, sy, ex, ey);
+    if (ex - sx > table.maxFilterWidth || ey - sy > table.maxFilterHeight)
+        return NAN;
+
+    int width = table.width;
+    uint32 A, B, C, D;
+    if (table.numBits <= 16)
+    {
+        const uint16* values = &table.values16[0];
+        A = (sx >= 0 && sy >= 0) ? values[sy*width + sx] : 0;
+        B = (sy >= 0) ? values[sy*width + ex] : 0;
+        C = (sx >= 0) ? values[ey*width + sx] : 0;
+        D = values[ey*width + ex];
+    }
+    else
+    {
+        const uint32* values = &table.values32[0];
+        A = (sx >= 0 && sy >= 0) ? values[sy*width + sx] : 0;
+        B = (sy >= 0) ? values[sy*width + ex] : 0;
+        C = (sx >= 0) ? values[ey*width + sx] : 0;
+        D = values[ey*width + ex];
+    }
+
+    uint32 maxValue = table.numBits == 32 ? uint32(-1) : (uint32(1) << table.numBits) - 1;
+    uint32 sum = (A + D - B - C) & maxValue;
+    return float(double(sum) / double((ey - sy) * (ex - sx)));
+}
+
+// ------------------ Bit packed tables ------------------
+
+static const int c_packedTablePadding = 32;
+
+template <typename T>
+int NumBitsForTableInternal(const T* values, size_t count)
+{
+    // two's complement needs a sign bit on top of the magnitude bits, which (value ^ (value >> 31)) counts
+    int numBits = 1;
+    for (size_t index = 0; index < count; ++index)
+    {
+        uint32 magnitude = std::is_signed<T>::value ? uint32(values[index] ^ (values[index] >> 31)) : uint32(values[index]);
+        int bits = std::is_signed<T>::value ? 1 : 0;
+        while (magnitude)
+        {
+            bits++;
+            magnitude >>= 1;
+        }
+        numBits = std::max(numBits, bits);
+    }
+    return numBits;
+}
+
+int NumBitsForTable(const uint32* values, size_t count)
+{
+    return NumBitsForTableInternal(values, count);
+}
+
+int NumBitsForTable(const int32* values, size_t count)
+{
+    return NumBitsForTableInternal(values, count);
+}
+
+void PackTable(const uint32* values, int width, int height, int numBits, PackedTable& table)
+{
+    table.width = width;
+    table.height = height;
+    table.numBits = numBits;
+
+    size_t count = size_t(width) * size_t(height);
+    table.bytes.clear();
+    table.bytes.resize((count * numBits + 7) / 8 + c_packedTablePadding, 0);
+
+    uint64_t mask = (uint64_t(1) << numBits) - 1;
+    uint8* bytes = &table.bytes[0];
+    for (size_t index = 0; index < count; ++index)
+    {
+        uint64_t bit = uint64_t(index) * uint64_t(numBits);
+        uint64_t word;
+        memcpy(&word, &bytes[bit / 8], sizeof(word));
+        word |= (uint64_t(values[index]) & mask) << (bit % 8);
+        memcpy(&bytes[bit / 8], &word, sizeof(word));
+    }
+}
+
+void PackTable(const int32* values, int width, int height, int numBits, PackedTable& table)
+{
+    // the low bits of two's complement are the same as the low bits of the value as unsigned
+    PackTable((const uint32*)values, width, height, numBits, table);
+}
+
+inline uint32 PackedTableValue(const uint8* bytes, size_t index, int numBits, uint32 mask)
+{
+    uint64_t bit = uint64_t(index) * uint64_t(numBits);
+    uint64_t word;
+    memcpy(&word, &bytes[bit / 8], sizeof(word));
+    return uint32(word >> (bit % 8)) & mask;
+}
+
+inline int32 SignExtend(uint32 value, int numBits)
+{
+    return int32(value << (32 - numBits)) >> (32 - numBits);
+}
+
+// signExtend treats the values as two's complement numBits bit numbers
+void UnpackTableValues_Scalar(const uint8* bytes, size_t index, int count, int numBits, bool signExtend, uint32* values)
+{
+    uint32 mask = numBits == 32 ? uint32(-1) : (uint32(1) << numBits) - 1;
+    for (int offset = 0; offset < count; ++offset)
+    {
+        uint32 value = PackedTableValue(bytes, index + offset, numBits, mask);
+        values[offset] = signExtend ? uint32(SignExtend(value, numBits)) : value;
+    }
+}
+
+#if AAT_X86
+// Eight values of numBits bits take exactly numBits bytes, so every group of eight starts at the same bit offset within
+// its first byte. That means one set of word indices and shifts, worked out up front, unpacks every group from a
+// 32 byte load. Only for numBits < 32, where the eight values fit in the 32 bytes wherever they start.
+TARGET_AVX2 void UnpackTableValues_AVX2(const uint8* bytes, size_t index, int count, int numBits, bool signExtend, uint32* values)
+{
+    uint64_t firstBit = uint64_t(index) * uint64_t(numBits);
+    const uint8* source = &bytes[firstBit / 8];
+    int startBit = int(firstBit % 8);
+
+    int32 lowWord[8], shift[8];
+    for (int lane = 0; lane < 8; ++lane)
+    {
+        int bit = startBit + lane * numBits;
+        lowWord[lane] = bit / 32;
+        shift[lane] = bit % 32;
+    }
+
+    const __m256i lowWordV = _mm256_loadu_si256((const __m256i*)lowWord);
+    const __m256i highWordV = _mm256_add_epi32(lowWordV, _mm256_set1_epi32(1));
+    const __m256i shiftV = _mm256_loadu_si256((const __m256i*)shift);
+    const __m256i highShiftV = _mm256_sub_epi32(_mm256_set1_epi32(32), shiftV);
+    const __m256i mask = _mm256_set1_epi32(int((1u << numBits) - 1));
+    const __m128i signShift = _mm_cvtsi32_si128(signExtend ? 32 - numBits : 0);
+
+    int offset = 0;
+    for (; offset + 8 <= count; offset += 8)
+    {
+        __m256i words = _mm256_loadu_si256((const __m256i*)source);
+        source += numBits;
+
+        // A shift of 32 gives 0, for values that don't continue into the next word. When the last lane's next word
+        // index wraps to 0, that lane's value ends in its own word, so the extra bits land above numBits and get masked.
+        __m256i low = _mm256_srlv_epi32(_mm256_permutevar8x32_epi32(words, lowWordV), shiftV);
+        __m256i high = _mm256_sllv_epi32(_mm256_permutevar8x32_epi32(words, highWordV), highShiftV);
+        __m256i value = _mm256_and_si256(_mm256_or_si256(low, high), mask);
+        value = _mm256_sra_epi32(_mm256_sll_epi32(value, signShift), signShift);
+        _mm256_storeu_si256((__m256i*)&values[offset], value);
+    }
+
+    UnpackTableValues_Scalar(bytes, index + offset, count - offset, numBits, signExtend, &values[offset]);
+}
+#endif // AAT_X86
+
+void UnpackTableValues(const PackedTable& table, size_t index, int count, bool signExtend, uint32* values)
+{
+    if (table.numBits == 32)
+    {
+        memcpy(values, &table.bytes[index * 4], count * sizeof(uint32));
+        return;
+    }
+
+#if AAT_X86
+    if (g_allowSIMD && GetCPUFeatures().avx2)
+    {
+        UnpackTableValues_AVX2(&table.bytes[0], index, count, table.numBits, signExtend, values);
+        return;
+    }
+#endif
+    UnpackTableValues_Scalar(&table.bytes[0], index, count, table.numBits, signExtend, values);
+}
+
+void UnpackTableValues(const PackedTable& table, size_t index, int count, uint32* values)
+{
+    UnpackTableValues(table, index, count, false, values);
+}
+
+void UnpackTableValues(const PackedTable& table, size_t index, int count, int32* values)
+{
+    UnpackTableValues(table, index, count, true, (uint32*)values);
+}
+
+// Same as SATBoxBlurPixel with a scale of 1, reading a packed table
+inline uint8 SATBoxBlurPackedPixel(const PackedTable& SAT, int radius, int ix, int iy, uint32 maxValue, double reciprocalArea)
+{
+	int width = SAT.width;
+	int startX = std::max(ix - radius - 1, -1);
+	int startY = std::max(iy - radius - 1, -1);
+
+	int endX = std::min(ix + radius, width - 1);
+	int endY = std::min(iy + radius, SAT.height - 1);
+
+	const uint8* bytes = &SAT.bytes[0];
+	uint32 A = (startX >= 0 && startY >= 0) ? PackedTableValue(bytes, size_t(startY)*width + startX, SAT.numBits, maxValue) : 0;
+	uint32 B = (startY >= 0) ? PackedTableValue(bytes, size_t(startY)*width + endX, SAT.numBits, maxValue) : 0;
+	uint32 C = (startX >= 0) ? PackedTableValue(bytes, size_t(endY)*width + startX, SAT.numBits, maxValue) : 0;
+	uint32 D = PackedTableValue(bytes, size_t(endY)*width + endX, SAT.numBits, maxValue);
+
+	uint32 integratedValue = (A + D - B - C) & maxValue;
+
+	return uint8(0.5 + c_reciprocalRoundingNudge + double(integratedValue) * reciprocalArea);
+}
+
+// Same as SATBoxBlurBiasedPixel, reading a packed table
+inline uint8 SATBoxBlurBiasedPackedPixel(const PackedTable& SAT, int radius, int ix, int iy, int bias, uint32 mask, double reciprocalArea)
+{
+	int width = SAT.width;
+	int startX = std::max(ix - radius - 1, -1);
+	int startY = std::max(iy - radius - 1, -1);
+
+	int endX = std::min(ix + radius, width - 1);
+	int endY = std::min(iy + radius, SAT.height - 1);
+
+	const uint8* bytes = &SAT.bytes[0];
+	int numBits = SAT.numBits;
+	int32 A = (startX >= 0 && startY >= 0) ? SignExtend(PackedTableValue(bytes, size_t(startY)*width + startX, numBits, mask), numBits) : bias;
+	int32 B = (startY >= 0) ? SignExtend(PackedTableValue(bytes, size_t(startY)*width + endX, numBits, mask), numBits) : -bias;
+	int32 C = (startX >= 0) ? SignExtend(PackedTableValue(bytes, size_t(endY)*width + startX, numBits, mask), numBits) : -bias;
+	int32 D = SignExtend(PackedTableValue(bytes, size_t(endY)*width + endX, numBits, mask), numBits);
+
+	int32 integratedValue = (A + D - B - C);
+
+	return uint8(double(bias) + 0.5 + c_reciprocalRoundingNudge + double(integratedValue) * reciprocalArea);
+}
+
+void SATBoxBlurPackedImage(const PackedTable& SAT, int radius, std::vector<uint8>& result, const BlurOptions& options)
+{
+	int width = SAT.width;
+	int height = SAT.height;
+	result.resize(width * height);
+
+	uint32 maxValue = SAT.numBits == 32 ? uint32(-1) : uint32(1 << SAT.numBits) - 1;
+
+	int diameter = radius * 2 + 1;
+
+	SATBoxBlurInteriorKernel interiorKernel = GetSATBoxBlurInteriorKernel();
+
+	BoxAreaReciprocals areas(width, height, radius);
+
+	// the two table rows an interior span reads, unpacked
+	std::vector<uint32> rowA(width), rowC(width);
+
+	ForEachBlurPixel(width, height, radius, options,
+		[&](int ix, int iy)
+		{
+			result[iy*width + ix] = SATBoxBlurPackedPixel(SAT, radius, ix, iy, maxValue, areas.Area(ix, iy));
+		},
+		[&](int ix, int iy, int count)
+		{
+			int startX = ix - radius - 1;
+			UnpackTableValues(SAT, size_t(iy - radius - 1)*width + startX, count + diameter, &rowA[0]);
+			UnpackTableValues(SAT, size_t(iy + radius)*width + startX, count + diameter, &rowC[0]);
+			return interiorKernel(&rowA[0], &rowC[0], diameter, count, 1, maxValue, areas.interior, &result[iy*width + ix]);
+		}
+	);
+}
+
+void SATBoxBlurBiasedPackedImage(const PackedTable& SAT, int radius, int bias, std::vector<uint8>& result, const BlurOptions& options)
+{
+	int width = SAT.width;
+	int height = SAT.height;
+	result.resize(width * height);
+
+	uint32 mask = SAT.numBits == 32 ? uint32(-1) : uint32(1 << SAT.numBits) - 1;
+
+	int diameter = radius * 2 + 1;
+
+	BoxAreaReciprocals areas(width, height, radius);
+
+	std::vector<int32> rowA(width), rowC(width);
+
+	ForEachBlurPixel(width, height, radius, options,
+		[&](int ix, int iy)
+		{
+			result[iy*width + ix] = SATBoxBlurBiasedPackedPixel(SAT, radius, ix, iy, bias, mask, areas.Area(ix, iy));
+		},
+		[&](int ix, int iy, int count)
+		{
+			int startX = ix - radius - 1;
+			UnpackTableValues(SAT, size_t(iy - radius - 1)*width + startX, count + diameter, &rowA[0]);
+			UnpackTableValues(SAT, size_t(iy + radius)*width + startX, count + diameter, &rowC[0]);
+			return SATBoxBlurBiasedInterior(&rowA[0], &rowC[0], diameter, count, bias, areas.interior, &result[iy*width + ix]);
+		}
+	);
+}
+
+// ------------------ Scaled SATs ------------------
+
+int ScaledSATDroppedBits(int maxFilterWidth, int maxFilterHeight, int storageBits)
+{
+    // A box sum of rounded corners is within 2 steps of the real sum, so it is in [-2, largest + 2]. The two values at
+    // the top of the range are kept for -2 and -1, which leaves 2^storageBits - 2 values for [0, largest + 2].
+    uint64_t largest = uint64_t(255) * uint64_t(maxFilterWidth) * uint64_t(maxFilterHeight);
+    uint64_t numValues = (uint64_t(1) << storageBits) - 2;
+    int droppedBits = 0;
+    while (((largest + (uint64_t(1) << droppedBits) - 1) >> droppedBits) + 3 > numValues)
+        droppedBits++;
+    return droppedBits;
+}
+
+int ScaledSATSmallestBoxArea(int minFilterWidth, int minFilterHeight)
+{
+    return ((minFilterWidth + 1) / 2) * ((minFilterHeight + 1) / 2);
+}
+
+bool BuildScaledSAT(const uint8* source, int width, int height, int minFilterWidth, int minFilterHeight, int maxFilterWidth, int maxFilterHeight, int storageBits, ScaledSAT& table)
+{
+    assert(storageBits == 16 || storageBits == 24);
+    assert(minFilterWidth <= maxFilterWidth && minFilterHeight <= maxFilterHeight);
+
+    table.width = width;
+    table.height = height;
+    table.minFilterWidth = minFilterWidth;
+    table.minFilterHeight = minFilterHeight;
+    table.maxFilterWidth = maxFilterWidth;
+    table.maxFilterHeight = maxFilterHeight;
+    table.storageBits = storageBits;
+    table.droppedBits = ScaledSATDroppedBits(maxFilterWidth, maxFilterHeight, storageBits);
+    table.values16.clear();
+    table.values24 = PackedTable();
+
+    // The 32 bit SAT wraps at 2^32, and rounding that down by droppedBits then wrapping at 2^storageBits gives the same
+    // values as doing it to the real SAT, as long as storageBits + droppedBits fits in 32 bits. The bits dropped for
+    // the largest box also have to leave the smallest box within half a level.
+    if (storageBits + table.droppedBits > 32)
+        return false;
+    if (ScaledSATMaxError(table, ScaledSATSmallestBoxArea(minFilterWidth, minFilterHeight)) > c_scaledSATMaxError)
+        return false;
+
+    std::vector<uint32> SAT;
+    BuildSATParallel(source, width, height, SAT);
+
+    int droppedBits = table.droppedBits;
+    uint64_t half = droppedBits > 0 ? uint64_t(1) << (droppedBits - 1) : 0;
+    uint32 mask = (uint32(1) << storageBits) - 1;
+    GetThreadPool().ParallelFor(height, [&](int begin, int end)
+    {
+        for (size_t index = size_t(begin) * width; index < size_t(end) * width; ++index)
+            SAT[index] = uint32((uint64_t(SAT[index]) + half) >> droppedBits) & mask;
+    });
+
+    if (storageBits == 16)
+        table.values16.assign(SAT.begin(), SAT.end());
+    else
+        PackTable(&SAT[0], width, height, 24, table.values24);
+    return true;
+}
+
+double ScaledSATMaxError(const ScaledSAT& table, int boxArea)
+{
+    return 2.0 * double(uint64_t(1) << table.droppedBits) / double(boxArea);
+}
+
+// Reads count table values starting at index as uint32s
+inline void ReadScaledSATValues(const ScaledSAT& table, size_t index, int count, uint32* values)
+{
+    if (table.storageBits == 16)
+    {
+        const uint16* values16 = &table.values16[index];
+        for (int i = 0; i < count; ++i)
+            values[i] = values16[i];
+    }
+    else
+    {
+        UnpackTableValues(table.values24, index, count, values);
+    }
+}
+
+// Turns a box sum of rounded corners into an 8 bit average. Sums in the top two values of the table are -2 and -1,
+// which clamp to 0, as do any sums that come out a little past 255. scaleOverArea is 2^droppedBits times the reciprocal
+// area, and the rounding is the same as SATBoxBlurImage's, so a table with no bits dropped gives the same results.
+inline uint8 ScaledSATBoxAverage(uint32 sum, uint32 mask, double scaleOverArea)
+{
+    int32 signedSum = sum > mask - 2 ? int32(sum) - int32(mask) - 1 : int32(sum);
+    double value = 0.5 + c_reciprocalRoundingNudge + double(signedSum) * scaleOverArea;
+    return uint8(std::min(std::max(value, 0.0), 255.0));
+}
+
+inline uint8 ScaledSATBoxBlurPixel(const ScaledSAT& table, int radius, int ix, int iy, uint32 mask, double reciprocalArea)
+{
+	int width = table.width;
+	int startX = std::max(ix - radius - 1, -1);
+	int startY = std::max(iy - radius - 1, -1);
+
+	int endX = std::min(ix + radius, width - 1);
+	int endY = std::min(iy + radius, table.height - 1);
+
+	uint32 A = 0, B = 0, C = 0, D;
+	if (startX >= 0 && startY >= 0)
+		ReadScaledSATValues(table, size_t(startY)*width + startX, 1, &A);
+	if (startY >= 0)
+		ReadScaledSATValues(table, size_t(startY)*width + endX, 1, &B);
+	if (startX >= 0)
+		ReadScaledSATValues(table, size_t(endY)*width + startX, 1, &C);
+	ReadScaledSATValues(table, size_t(endY)*width + endX, 1, &D);
+
+	double scaleOverArea = double(uint64_t(1) << table.droppedBits) * reciprocalArea;
+
+	return ScaledSATBoxAverage((A + D - B - C) & mask, mask, scaleOverArea);
+}
+
+typedef int(*ScaledSATBoxBlurInteriorKernel)(const uint32* A, const uint32* C, int diameter, int count, uint32 mask, double scaleOverArea, uint8* result);
+
+int ScaledSATBoxBlurInterior_Scalar(const uint32* A, const uint32* C, int diameter, int count, uint32 mask, double scaleOverArea, uint8* result)
+{
+    for (int index = 0; index < count; ++index)
+        result[index] = ScaledSATBoxAverage((A[index] + C[index + diameter] - A[index + diameter] - C[index]) & mask, mask, scaleOverArea);
+    return count;
+}
+
+#if AAT_X86
+TARGET_AVX2 int ScaledSATBoxBlurInterior_AVX2(const uint32* A, const uint32* C, int diameter, int count, uint32 mask, double scaleOverArea, uint8* result)
+{
+    // the table is at most 24 bits, so sums compare and convert to double as signed ints
+    const __m256i maskV = _mm256_set1_epi32(int(mask));
+    const __m256i negativeStart = _mm256_set1_epi32(int(mask - 2));
+    const __m256i wrap = _mm256_set1_epi32(int(mask + 1));
+    const __m256d scaleOverAreaV = _mm256_set1_pd(scaleOverArea);
+    const __m256d half = _mm256_set1_pd(0.5 + c_reciprocalRoundingNudge);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d maxValue = _mm256_set1_pd(255.0);
+    const __m128i lowBytes = _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+
+    int index = 0;
+    for (; index + 8 <= count; index += 8)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i*)&A[index]);
+        __m256i b = _mm256_loadu_si256((const __m256i*)&A[index + diameter]);
+        __m256i c = _mm256_loadu_si256((const __m256i*)&C[index]);
+        __m256i d = _mm256_loadu_si256((const __m256i*)&C[index + diameter]);
+
+        __m256i sum = _mm256_and_si256(_mm256_sub_epi32(_mm256_sub_epi32(_mm256_add_epi32(a, d), b), c), maskV);
+        __m256i negative = _mm256_cmpgt_epi32(sum, negativeStart);
+        sum = _mm256_sub_epi32(sum, _mm256_and_si256(negative, wrap));
+
+        __m256d lo = _mm256_add_pd(half, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(sum)), scaleOverAreaV));
+        __m256d hi = _mm256_add_pd(half, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(sum, 1)), scaleOverAreaV));
+        lo = _mm256_min_pd(_mm256_max_pd(lo, zero), maxValue);
+        hi = _mm256_min_pd(_mm256_max_pd(hi, zero), maxValue);
+
+        __m128i loInt = _mm_shuffle_epi8(_mm256_cvttpd_epi32(lo), lowBytes);
+        __m128i hiInt = _mm_shuffle_epi8(_mm256_cvttpd_epi32(hi), lowBytes);
+        _mm_storel_epi64((__m128i*)&result[index], _mm_unpacklo_epi32(loInt, hiInt));
+    }
+    return index;
+}
+#endif // AAT_X86
+
+ScaledSATBoxBlurInteriorKernel GetScaledSATBoxBlurInteriorKernel()
+{
+#if AAT_X86
+    if (g_allowSIMD && GetCPUFeatures().avx2)
+        return ScaledSATBoxBlurInterior_AVX2;
+#endif
+    return ScaledSATBoxBlurInterior_Scalar;
+}
+
+bool ScaledSATBoxBlurImage(const ScaledSAT& table, int radius, std::vector<uint8>& result, const BlurOptions& options)
+{
+	int diameter = radius * 2 + 1;
+	if (diameter < table.minFilterWidth || diameter < table.minFilterHeight || diameter > table.maxFilterWidth || diameter > table.maxFilterHeight)
+	{
+		result.clear();
+		return false;
+	}
+
+	int width = table.width;
+	int height = table.height;
+	result.resize(width * height);
+
+	uint32 mask = (uint32(1) << table.storageBits) - 1;
+	BoxAreaReciprocals areas(width, height, radius);
+	double scaleOverArea = double(uint64_t(1) << table.droppedBits) * areas.interior;
+
+	ScaledSATBoxBlurInteriorKernel interiorKernel = GetScaledSATBoxBlurInteriorKernel();
+
+	// the two table rows an interior span reads, as uint32s
+	std::vector<uint32> rowA(width), rowC(width);
+
+	ForEachBlurPixel(width, height, radius, options,
+		[&](int ix, int iy)
+		{
+			result[iy*width + ix] = ScaledSATBoxBlurPixel(table, radius, ix, iy, mask, areas.Area(ix, iy));
+		},
+		[&](int ix, int iy, int count)
+		{
+			int startX = ix - radius - 1;
+			ReadScaledSATValues(table, size_t(iy - radius - 1)*width + startX, count + diameter, &rowA[0]);
+			ReadScaledSATValues(table, size_t(iy + radius)*width + startX, count + diameter, &rowC[0]);
+			return interiorKernel(&rowA[0], &rowC[0], diameter, count, mask, scaleOverArea, &result[iy*width + ix]);
+		}
+	);
+	return true;
+}
+
+// ------------------ RGBA tables ------------------
+
+// Where channel 0 of texel 0 is, how far apart texels are, and how far apart channels are, for either layout
+struct RGBATableLayout
+{
+    int texelStride;
+    size_t channelStride;
+
+    RGBATableLayout(ChannelLayout layout, int width, int height)
+    {
+        texelStride = (layout == ChannelLayout::Interleaved) ? 4 : 1;
+        channelStride = (layout == ChannelLayout::Interleaved) ? 1 : size_t(width) * size_t(height);
+    }
+};
+
+void BuildSATRGBA(const uint8* source, int width, int height, ChannelLayout layout, std::vector<uint32>& SAT)
+{
+    SAT.resize(size_t(width) * size_t(height) * 4);
+    if (layout == ChannelLayout::Interleaved)
+    {
+        BuildSATParallelInternal<uint32, 4>(source, 4, width, height, 0, &SAT[0]);
+    }
+    else
+    {
+        for (int channel = 0; channel < 4; ++channel)
+            BuildSATParallelInternal<uint32, 1>(&source[channel], 4, width, height, 0, &SAT[size_t(channel) * size_t(width) * size_t(height)]);
+    }
+}
+
+void BuildAATRGBA(const std::vector<uint32>& SAT, int width, int height, ChannelLayout layout, int scale, std::vector<uint32>& AAT)
+{
+    RGBATableLayout tableLayout(layout, width, height);
+    AAT.resize(SAT.size());
+
+    // Same math as BuildTableVariant with DitherKind::Round
+    GetThreadPool().ParallelFor(height, [&](int begin, int end)
+    {
+        for (int iy = begin; iy < end; ++iy)
+        {
+            for (int ix = 0; ix < width; ++ix)
+            {
+                double rangeSize = double(size_t(ix + 1)*size_t(iy + 1));
+                for (int channel = 0; channel < 4; ++channel)
+                {
+                    size_t index = size_t(iy*width + ix)*tableLayout.texelStride + channel*tableLayout.channelStride;
+                    AAT[index] = uint32(0.5f + float(scale) * (double(SAT[index]) / rangeSize));
+                }
+            }
+        }
+    });
+}
+
+// Same as SATBoxBlurPixel with a scale of 1 and 32 bits, for each channel. Writes 4 bytes.
+inline void SATBoxBlurPixelRGBA(const uint32* SAT, int width, int height, const RGBATableLayout& layout, int radius, int ix, int iy, double reciprocalArea, uint8* result)
+{
+	int startX = std::max(ix - radius - 1, -1);
+	int startY = std::max(iy - radius - 1, -1);
+
+	int endX = std::min(ix + radius, width - 1);
+	int endY = std::min(iy + radius, height - 1);
+
+	for (int channel = 0; channel < 4; ++channel)
+	{
+		const uint32* table = &SAT[channel * layout.channelStride];
+		uint32 A = (startX >= 0 && startY >= 0) ? table[(startY*width + startX)*layout.texelStride] : 0;
+		uint32 B = (startY >= 0) ? table[(startY*width + endX)*layout.texelStride] : 0;
+		uint32 C = (startX >= 0) ? table[(endY*width + startX)*layout.texelStride] : 0;
+		uint32 D = table[(endY*width + endX)*layout.texelStride];
+
+		uint32 integratedValue = A + D - B - C;
+		result[channel] = uint8(0.5 + c_reciprocalRoundingNudge + double(integratedValue) * reciprocalArea);
+	}
+}
+
+// Same as AATBoxBlurPixel for each channel. Writes 4 bytes.
+inline void AATBoxBlurPixelRGBA(const uint32* AAT, int width, int height, const RGBATableLayout& layout, int radius, int ix, int iy, int scale, double reciprocalArea, uint8* result)
+{
+	int startX = std::max(ix - radius - 1, -1);
+	int startY = std::max(iy - radius - 1, -1);
+
+	int endX = std::min(ix + radius, width - 1);
+	int endY = std::min(iy + radius, height - 1);
+
+	for (int channel = 0; channel < 4; ++channel)
+	{
+		const uint32* table = &AAT[channel * layout.channelStride];
+
+		float A = float((startX >= 0 && startY >= 0) ? table[(startY*width + startX)*layout.texelStride] : 0) / float(256 * scale);
+		A *= float((startY + 1)*(startX + 1));
+
+		float B = float((startY >= 0) ? table[(startY*width + endX)*layout.texelStride] : 0) / float(256 * scale);
+		B *= float((startY + 1)*(endX + 1));
+
+		float C = float((startX >= 0) ? table[(endY*width + startX)*layout.texelStride] : 0) / float(256 * scale);
+		C *= float((endY + 1)*(startX + 1));
+
+		float D = float(table[(endY*width + endX)*layout.texelStride]) / float(256 * scale);
+		D *= float((endY + 1)*(endX + 1));
+
+		float integratedValue = A + D - B - C;
+		result[channel] = uint8(0.5f + AATDivideByArea(255.0f * integratedValue, reciprocalArea));
+	}
+}
+
+// Interleaved AAT interior pixels. Same math as AATBoxBlurInterior, with the four channels of a pixel sharing the corner areas.
+typedef int(*AATBoxBlurInteriorRGBAKernel)(const uint32* A, const uint32* C, int diameter, int count, int startX, int startY, int endY, int scale, double reciprocalArea, uint8* result);
+
+int AATBoxBlurInteriorRGBA_Scalar(const uint32* A, const uint32* C, int diameter, int count, int startX, int startY, int endY, int scale, double reciprocalArea, uint8* result)
+{
+	float divisor = float(256 * scale);
+	for (int index = 0; index < count; ++index)
+	{
+		int cornerStartX = startX + index;
+		int cornerEndX = cornerStartX + diameter;
+
+		float areaA = float((startY + 1)*(cornerStartX + 1));
+		float areaB = float((startY + 1)*(cornerEndX + 1));
+		float areaC = float((endY + 1)*(cornerStartX + 1));
+		float areaD = float((endY + 1)*(cornerEndX + 1));
+
+		for (int channel = 0; channel < 4; ++channel)
+		{
+			float a = float(A[index * 4 + channel]) / divisor * areaA;
+			float b = float(A[(index + diameter) * 4 + channel]) / divisor * areaB;
+			float c = float(C[index * 4 + channel]) / divisor * areaC;
+			float d = float(C[(index + diameter) * 4 + channel]) / divisor * areaD;
+
+			float integratedValue = a + d - b - c;
+			result[index * 4 + channel] = uint8(0.5f + AATDivideByArea(255.0f * integratedValue, reciprocalArea));
+		}
+	}
+	return count;
+}
+
+#if AAT_X86
+// uint32 to float with a single rounding, like float(uint32) does
+TARGET_SSE41 inline __m128 UInt32ToFloat4(__m128i value)
+{
+    __m128 hi = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(value, 16)), _mm_set1_ps(65536.0f));
+    __m128 lo = _mm_cvtepi32_ps(_mm_and_si128(value, _mm_set1_epi32(0xffff)));
+    return _mm_add_ps(hi, lo);
+}
+
+// One pixel's four channels per register
+TARGET_SSE41 int AATBoxBlurInteriorRGBA_SSE41(const uint32* A, const uint32* C, int diameter, int count, int startX, int startY, int endY, int scale, double reciprocalArea, uint8* result)
+{
+    const __m128 divisor = _mm_set1_ps(float(256 * scale));
+    const __m128d reciprocal = _mm_set1_pd(reciprocalArea);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 maxValue = _mm_set1_ps(255.0f);
+    const __m128i lowBytes = _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+
+    for (int index = 0; index < count; ++index)
+    {
+        int cornerStartX = startX + index;
+        int cornerEndX = cornerStartX + diameter;
+
+        __m128 a = _mm_div_ps(UInt32ToFloat4(_mm_loadu_si128((const __m128i*)&A[index * 4])), divisor);
+        __m128 b = _mm_div_ps(UInt32ToFloat4(_mm_loadu_si128((const __m128i*)&A[(index + diameter) * 4])), divisor);
+        __m128 c = _mm_div_ps(UInt32ToFloat4(_mm_loadu_si128((const __m128i*)&C[index * 4])), divisor);
+        __m128 d = _mm_div_ps(UInt32ToFloat4(_mm_loadu_si128((const __m128i*)&C[(index + diameter) * 4])), divisor);
+
+        a = _mm_mul_ps(a, _mm_set1_ps(float((startY + 1)*(cornerStartX + 1))));
+        b = _mm_mul_ps(b, _mm_set1_ps(float((startY + 1)*(cornerEndX + 1))));
+        c = _mm_mul_ps(c, _mm_set1_ps(float((endY + 1)*(cornerStartX + 1))));
+        d = _mm_mul_ps(d, _mm_set1_ps(float((endY + 1)*(cornerEndX + 1))));
+
+        __m128 integratedValue = _mm_mul_ps(maxValue, _mm_sub_ps(_mm_sub_ps(_mm_add_ps(a, d), b), c));
+
+        // divide by area in double like AATDivideByArea
+        __m128 valueLo = _mm_cvtpd_ps(_mm_mul_pd(_mm_cvtps_pd(integratedValue), reciprocal));
+        __m128 valueHi = _mm_cvtpd_ps(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(integratedValue, integratedValue)), reciprocal));
+        __m128 value = _mm_add_ps(half, _mm_movelh_ps(valueLo, valueHi));
+
+        // keep the low byte of each int like uint8(float) does, rather than saturating
+        __m128i bytes = _mm_shuffle_epi8(_mm_cvttps_epi32(value), lowBytes);
+        int packed = _mm_cvtsi128_si32(bytes);
+        memcpy(&result[index * 4], &packed, 4);
+    }
+    return count;
+}
+
+// Two pixels per register, one in each 128 bit lane
+TARGET_AVX2 int AATBoxBlurInteriorRGBA_AVX2(const uint32* A, const uint32* C, int diameter, int count, int startX, int startY, int endY, int scale, double reciprocalArea, uint8* result)
+{
+    const __m256 divisor = _mm256_set1_ps(float(256 * scale));
+    const __m256d reciprocal = _mm256_set1_pd(reciprocalArea);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 maxValue = _mm256_set1_ps(255.0f);
+    const __m256i lowBytes = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+
+    int index = 0;
+    for (; index + 2 <= count; index += 2)
+    {
+        int cornerStartX = startX + index;
+        int cornerEndX = cornerStartX + diameter;
+
+        __m256 a = _mm256_div_ps(UInt32ToFloat8(_mm256_loadu_si256((const __m256i*)&A[index * 4])), divisor);
+        __m256 b = _mm256_div_ps(UInt32ToFloat8(_mm256_loadu_si256((const __m256i*)&A[(index + diameter) * 4])), divisor);
+        __m256 c = _mm256_div_ps(UInt32ToFloat8(_mm256_loadu_si256((const __m256i*)&C[index * 4])), divisor);
+        __m256 d = _mm256_div_ps(UInt32ToFloat8(_mm256_loadu_si256((const __m256i*)&C[(index + diameter) * 4])), divisor);
+
+        // the second pixel's corners are one column further along
+        a = _mm256_mul_ps(a, _mm256_setr_m128(_mm_set1_ps(float((startY + 1)*(cornerStartX + 1))), _mm_set1_ps(float((startY + 1)*(cornerStartX + 2)))));
+        b = _mm256_mul_ps(b, _mm256_setr_m128(_mm_set1_ps(float((startY + 1)*(cornerEndX + 1))), _mm_set1_ps(float((startY + 1)*(cornerEndX + 2)))));
+        c = _mm256_mul_ps(c, _mm256_setr_m128(_mm_set1_ps(float((endY + 1)*(cornerStartX + 1))), _mm_set1_ps(float((endY + 1)*(cornerStartX + 2)))));
+        d = _mm256_mul_ps(d, _mm256_setr_m128(_mm_set1_ps(float((endY + 1)*(cornerEndX + 1))), _mm_set1_ps(float((endY + 1)*(cornerEndX + 2)))));
+
+        __m256 integratedValue = _mm256_mul_ps(maxValue, _mm256_sub_ps(_mm256_sub_ps(_mm256_add_ps(a, d), b), c));
+
+        // divide by area in double like AATDivideByArea
+        __m128 valueLo = _mm256_cvtpd_ps(_mm256_mul_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(integratedValue)), reciprocal));
+        __m128 valueHi = _mm256_cvtpd_ps(_mm256_mul_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(integratedValue, 1)), reciprocal));
+        __m256 value = _mm256_add_ps(half, _mm256_setr_m128(valueLo, valueHi));
+
+        __m256i bytes = _mm256_shuffle_epi8(_mm256_cvttps_epi32(value), lowBytes);
+        int packed[2] = { _mm_cvtsi128_si32(_mm256_castsi256_si128(bytes)), _mm_cvtsi128_si32(_mm256_extracti128_si256(bytes, 1)) };
+        memcpy(&result[index * 4], packed, 8);
+    }
+    return index;
+}
+#endif // AAT_X86
+
+AATBoxBlurInteriorRGBAKernel GetAATBoxBlurInteriorRGBAKernel()
+{
+#if AAT_X86
+    if (g_allowSIMD && GetCPUFeatures().avx2)
+        return AATBoxBlurInteriorRGBA_AVX2;
+    if (g_allowSIMD && GetCPUFeatures().sse41)
+        return AATBoxBlurInteriorRGBA_SSE41;
+#endif
+    return AATBoxBlurInteriorRGBA_Scalar;
+}
+
+// Runs a single channel interior kernel on each plane of a planar table a chunk at a time, and interleaves the results.
+// kernel(channel, ix, count, result) returns how many pixels it wrote, which is the same for every channel.
+template <typename KERNEL>
+int PlanarBlurInterior(int ix, int count, uint8* result, const KERNEL& kernel)
+{
+    static const int c_chunkSize = 256;
+    uint8 planes[4][c_chunkSize];
+
+    int done = 0;
+    while (done < count)
+    {
+        int chunk = std::min(c_chunkSize, count - done);
+        int written = 0;
+        for (int channel = 0; channel < 4; ++channel)
+            written = kernel(channel, ix + done, chunk, planes[channel]);
+
+        for (int index = 0; index < written; ++index)
+        {
+            for (int channel = 0; channel < 4; ++channel)
+                result[(done + index) * 4 + channel] = planes[channel][index];
+        }
+
+        done += written;
+        if (written < chunk)
+            break;
+    }
+    return done;
+}
+
+void SATBoxBlurImageRGBA(const std::vector<uint32>& SAT, int width, int height, ChannelLayout layout, int radius, std::vector<uint8>& result, const BlurOptions& options)
+{
+	RGBATableLayout tableLayout(layout, width, height);
+	result.resize(SAT.size());
+
+	int diameter = radius * 2 + 1;
+
+	SATBoxBlurInteriorKernel interiorKernel = GetSATBoxBlurInteriorKernel();
+
+	BoxAreaReciprocals areas(width, height, radius);
+
+	ForEachBlurPixel(width, height, radius, options,
+		[&](int ix, int iy)
+		{
+			SATBoxBlurPixelRGBA(&SAT[0], width, height, tableLayout, radius, ix, iy, areas.Area(ix, iy), &result[(iy*width + ix) * 4]);
+		},
+		[&](int ix, int iy, int count)
+		{
+			if (layout == ChannelLayout::Interleaved)
+			{
+				// The interleaved channels of a row are one long row of a single channel table, with corners 4x further apart
+				const uint32* A = &SAT[((iy - radius - 1)*width + ix - radius - 1) * 4];
+				const uint32* C = &SAT[((iy + radius)*width + ix - radius - 1) * 4];
+				return interiorKernel(A, C, diameter * 4, count * 4, 1, uint32(-1), areas.interior, &result[(iy*width + ix) * 4]) / 4;
+			}
+
+			return PlanarBlurInterior(ix, count, &result[(iy*width + ix) * 4],
+				[&](int channel, int x, int chunk, uint8* planeResult)
+				{
+					const uint32* plane = &SAT[channel * tableLayout.channelStride];
+					const uint32* A = &plane[(iy - radius - 1)*width + x - radius - 1];
+					const uint32* C = &plane[(iy + radius)*width + x - radius - 1];
+					return interiorKernel(A, C, diameter, chunk, 1, uint32(-1), areas.interior, planeResult);
+				}
+			);
+		}
+	);
+}
+
+void AATBoxBlurImageRGBA(const std::vector<uint32>& AAT, int width, int height, ChannelLayout layout, int radius, int scale, std::vector<uint8>& result, const BlurOptions& options)
+{
+	RGBATableLayout tableLayout(layout, width, height);
+	result.resize(AAT.size());
+
+	int diameter = radius * 2 + 1;
+
+	AATBoxBlurInteriorRGBAKernel interiorKernel = GetAATBoxBlurInteriorRGBAKernel();
+
+	BoxAreaReciprocals areas(width, height, radius);
+
+	std::vector<float> rowScratch(2 * (width + 1));
+
+	ForEachBlurPixel(width, height, radius, options,
+		[&](int ix, int iy)
+		{
+			AATBoxBlurPixelRGBA(&AAT[0], width, height, tableLayout, radius, ix, iy, scale, areas.Area(ix, iy), &result[(iy*width + ix) * 4]);
+		},
+		[&](int ix, int iy, int count)
+		{
+			int startY = iy - radius - 1;
+			int endY = iy + radius;
+
+			if (layout == ChannelLayout::Interleaved)
+			{
+				int startX = ix - radius - 1;
+				return interiorKernel(&AAT[(startY*width + startX) * 4], &AAT[(endY*width + startX) * 4], diameter, count, startX, startY, endY, scale, areas.interior, &result[(iy*width + ix) * 4]);
+			}
+
+			return PlanarBlurInterior(ix, count, &result[(iy*width + ix) * 4],
+				[&](int channel, int x, int chunk, uint8* planeResult)
+				{
+					const uint32* plane = &AAT[channel * tableLayout.channelStride];
+					int startX = x - radius - 1;
+					return AATBoxBlurInterior(&plane[startY*width + startX], &plane[endY*width + startX], diameter, chunk, startX, startY, endY, scale, areas.interior, &rowScratch[0], planeResult);
+				}
+			);
+		}
+	);
+}
@@ -0,0 +1,665 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <chrono>
+
+typedef uint8_t uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef int32_t int32;
+
+// The code uses the MSVC secure CRT functions. These give other compilers the same behavior.
+#ifndef _MSC_VER
+template <size_t N>
+inline int sprintf_s(char (&buffer)[N], const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int ret = vsnprintf(buffer, N, format, args);
+    va_end(args);
+    return ret;
+}
+
+template <size_t N>
+inline int strcat_s(char (&buffer)[N], const char* source)
+{
+    size_t length = strlen(buffer);
+    if (length + strlen(source) >= N)
+        return -1;
+    strcpy(&buffer[length], source);
+    return 0;
+}
+
+inline int fopen_s(FILE** file, const char* fileName, const char* mode)
+{
+    // 't' (text mode) is an MSVC extension. Text and binary are the same elsewhere.
+    char portableMode[8] = {};
+    for (size_t in = 0, out = 0; mode[in] && out < sizeof(portableMode) - 1; ++in)
+    {
+        if (mode[in] != 't')
+            portableMode[out++] = mode[in];
+    }
+    *file = fopen(fileName, portableMode);
+    return *file ? 0 : -1;
+}
+
+#ifndef _countof
+#define _countof(array) (sizeof(array) / sizeof((array)[0]))
+#endif
+#endif // _MSC_VER
+
+// ------------------ CPU features / threading ------------------
+
+// When false, every kernel with a SIMD version uses its scalar version instead. Useful for validating the SIMD paths.
+extern bool g_allowSIMD;
+
+struct CPUFeatures
+{
+    bool sse41 = false;
+    bool avx2 = false;
+    bool f16c = false;
+};
+
+const CPUFeatures& GetCPUFeatures();
+
+// A fixed set of worker threads with a work stealing scheduler. Each worker has its own job deque. Jobs added from a
+// worker go on that worker's deque and it runs them newest first, which keeps related work (and its memory) together.
+// Idle workers steal the oldest job from other workers' deques. Threads waiting on a JobGroup run jobs while they wait,
+// so waiting from inside a job is fine, and a pool with zero workers still works.
+class ThreadPool
+{
+public:
+    // Jobs added to the same group can be waited on together
+    struct JobGroup
+    {
+        std::atomic<int> remaining{ 0 };
+    };
+
+    ThreadPool(int numThreads)
+        : m_queues(std::max(numThreads, 1))
+    {
+        for (int index = 0; index < numThreads; ++index)
+            m_threads.emplace_back([this, index]() { WorkerThread(index); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_exiting = true;
+        }
+        m_wake.notify_all();
+        for (std::thread& thread : m_threads)
+            thread.join();
+    }
+
+    int NumThreads() const { return int(m_threads.size()); }
+
+    void AddJob(JobGroup& group, std::function<void()>&& job)
+    {
+        group.remaining++;
+
+        int queueIndex = (s_currentPool == this) ? s_currentWorker : int(m_nextQueue++ % m_queues.size());
+        {
+            std::lock_guard<std::mutex> lock(m_queues[queueIndex].mutex);
+            m_queues[queueIndex].jobs.push_back(Job{ std::move(job), &group });
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_pending++;
+        }
+        m_wake.notify_one();
+    }
+
+    // Runs jobs until every job in the group is done
+    void Wait(JobGroup& group)
+    {
+        int workerIndex = (s_currentPool == this) ? s_currentWorker : -1;
+        while (group.remaining > 0)
+        {
+            if (TryRunJob(workerIndex))
+                continue;
+
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_wake.wait_for(lock, std::chrono::milliseconds(1), [&]() { return group.remaining == 0 || m_pending > 0; });
+        }
+    }
+
+    // Calls callback(begin, end) over [0, count) split into about one chunk per thread, and waits for all of them.
+    void ParallelFor(int count, const std::function<void(int begin, int end)>& callback)
+    {
+        int numChunks = std::min(count, NumThreads() + 1);
+        if (numChunks <= 1)
+        {
+            if (count > 0)
+                callback(0, count);
+            return;
+        }
+
+        JobGroup group;
+        for (int chunk = 1; chunk < numChunks; ++chunk)
+        {
+            int begin = int(int64_t(count) * chunk / numChunks);
+            int end = int(int64_t(count) * (chunk + 1) / numChunks);
+            AddJob(group, [&callback, begin, end]() { callback(begin, end); });
+        }
+
+        // the calling thread does the first chunk itself
+        callback(0, int(count / numChunks));
+
+        Wait(group);
+    }
+
+private:
+    struct Job
+    {
+        std::function<void()> function;
+        JobGroup* group;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    // Takes the newest job from our own queue, or the oldest job from anyone else's, and runs it.
+    bool TryRunJob(int workerIndex)
+    {
+        Job job;
+        bool found = false;
+
+        if (workerIndex >= 0)
+        {
+            Queue& queue = m_queues[workerIndex];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.jobs.empty())
+            {
+                job = std::move(queue.jobs.back());
+                queue.jobs.pop_back();
+                found = true;
+            }
+        }
+
+        for (size_t offset = 1; !found && offset <= m_queues.size(); ++offset)
+        {
+            Queue& queue = m_queues[(workerIndex + offset) % m_queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.jobs.empty())
+            {
+                job = std::move(queue.jobs.front());
+                queue.jobs.pop_front();
+                found = true;
+            }
+        }
+
+        if (!found)
+            return false;
+
+        m_pending--;
+        job.function();
+
+        if (--job.group->remaining == 0)
+        {
+            // wake anyone waiting on this group
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_wake.notify_all();
+        }
+        return true;
+    }
+
+    void WorkerThread(int index)
+    {
+        s_currentPool = this;
+        s_currentWorker = index;
+
+        while (true)
+        {
+            if (TryRunJob(index))
+                continue;
+
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_wake.wait(lock, [this]() { return m_exiting || m_pending > 0; });
+            if (m_exiting && m_pending == 0)
+                return;
+        }
+    }
+
+    std::vector<std::thread> m_threads;
+    std::vector<Queue> m_queues;
+    std::atomic<uint32_t> m_nextQueue{ 0 };
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    std::atomic<int> m_pending{ 0 };
+    bool m_exiting = false;
+
+    static thread_local ThreadPool* s_currentPool;
+    static thread_local int s_currentWorker;
+};
+
+// 0 means use every core. Set from the command line before the pool is first used.
+extern int g_numThreads;
+
+ThreadPool& GetThreadPool();
+
+// ------------------ Ground truth ------------------
+
+// Box blur of the source image, done as a horizontal then a vertical pass, both clamped at the edges.
+// BoxBlurSlidingWindow is O(1) per pixel. BoxBlurReference is the original O(radius) per pixel version, for validation.
+void BoxBlurReference(const uint8* source, int width, int height, int radius, std::vector<uint8>& result);
+void BoxBlurSlidingWindow(const uint8* source, int width, int height, int radius, std::vector<uint8>& result);
+
+struct BlurError
+{
+    double meanAbsolute = 0.0;
+    double rootMeanSquare = 0.0;
+    int maximum = 0;
+};
+
+BlurError CompareToGroundTruth(const std::vector<uint8>& groundTruth, const std::vector<uint8>& result);
+
+// ------------------ Table construction ------------------
+
+// Makes the SAT, and the SAT of (source - 127) with a -127 border. The parallel version gives identical tables.
+void BuildSATs(const uint8* source, int width, int height, std::vector<uint32>& SAT, std::vector<int32>& SATBiased127);
+void BuildSATsParallel(const uint8* source, int width, int height, std::vector<uint32>& SAT, std::vector<int32>& SATBiased127);
+
+// Parallel builders for just one of the tables. The biased SAT is the SAT of (source - bias) with a -bias border.
+void BuildSATParallel(const uint8* source, int width, int height, std::vector<uint32>& SAT);
+void BuildSATBiasedParallel(const uint8* source, int width, int height, int32 bias, std::vector<int32>& SATBiased);
+
+enum class TableKind
+{
+    SAT,
+    AAT
+};
+
+enum class DitherKind
+{
+    Round,
+    White,
+    Blue
+};
+
+// Describes one quantized table made from the full precision SAT.
+// For SATs, scale is how much the values are divided by (losing low bits).
+// For AATs, scale is how many steps there are per unit of average (extra bits of precision beyond 8).
+struct TableVariant
+{
+    TableKind kind;
+    DitherKind dither;
+    int scale;
+    const char* technique;
+};
+
+// A noise texture that is tiled across the image
+struct NoiseTexture
+{
+    const uint8* pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+};
+
+// Makes a single variant from the full precision SAT into table, reusing its memory.
+// White noise comes from an rng seeded with whiteNoiseSeed, so every variant built with the same seed sees the same
+// white noise value at each pixel, like they would if they were all built in one pass.
+void BuildTableVariant(const std::vector<uint32>& SAT, int width, int height, const TableVariant& variant, const NoiseTexture& blueNoiseTexture, uint32 whiteNoiseSeed, std::vector<uint32>& table);
+
+// Software float <-> IEEE binary16 conversions. FloatsToHalves uses F16C when available, with identical results.
+uint16 FloatToHalf(float value);
+float HalfToFloat(uint16 value);
+void FloatsToHalves(const float* source, uint16* dest, int count);
+
+// Makes an AAT stored as half floats. Values are the average normalized to [0,1], like a unorm texture would give a shader.
+void BuildAATHalf(const std::vector<uint32>& SAT, int width, int height, std::vector<uint16>& AATHalf);
+
+// A SAT stored as a low resolution SAT, plus higher resolution levels that only store the detail the level above misses.
+// * Level 0 holds actual SAT values, sampled every stride texels.
+// * Each level after that has blockSize times the resolution of the one before it. Its values are the difference
+//   between the SAT and the bilinear interpolation of the level before it. The last level has a value per texel.
+// * Grid points are at multiples of the level's stride, plus the last row / column of the image.
+// Differences are stored mod 2^32 so reconstruction is always exact. Each level only needs as many bits as its
+// largest difference, which is what HierarchicalSATBitsPerTexel reports.
+struct HierarchicalSAT
+{
+    struct Level
+    {
+        int stride = 1;
+        int gridWidth = 0;
+        int gridHeight = 0;
+        int numBits = 0;
+        std::vector<int32> values;
+    };
+
+    int width = 0;
+    int height = 0;
+    int blockSize = 0;
+    std::vector<Level> levels;
+};
+
+void BuildHierarchicalSAT(const std::vector<uint32>& SAT, int width, int height, int blockSize, int numLevels, HierarchicalSAT& table);
+
+// Returns the SAT value at a texel. Costs 5 loads for 2 levels, and about 4x more for each level past that.
+uint32 QueryHierarchicalSAT(const HierarchicalSAT& table, int x, int y);
+
+double HierarchicalSATBitsPerTexel(const HierarchicalSAT& table);
+
+// ------------------ Streaming SAT construction ------------------
+
+// Builds a SAT one row at a time, for images too big to hold in memory. Only the latest SAT row is kept, so memory
+// is O(width). Each row it returns is the same as that row of the SAT BuildSATs makes.
+class StreamingSATBuilder
+{
+public:
+    explicit StreamingSATBuilder(int width)
+        : m_width(width)
+        , m_row(width, 0)
+    {
+    }
+
+    // Adds the next source row and returns the SAT row for it, which is valid until the next call
+    const uint32* AddRow(const uint8* sourceRow);
+
+    int Width() const { return m_width; }
+    int RowsAdded() const { return m_rowsAdded; }
+
+private:
+    int m_width = 0;
+    int m_rowsAdded = 0;
+    std::vector<uint32> m_row;
+};
+
+// Pulls height rows of width pixels from readRow and hands each finished SAT row to writeRow, which can write it to
+// a file or a memory mapping. Either callback returns false to stop early, in which case this returns false.
+bool BuildSATStreaming(int width, int height, const std::function<bool(uint8* row)>& readRow, const std::function<bool(const uint32* row)>& writeRow);
+
+// ------------------ Table blurs ------------------
+
+// Options for how the table blurs walk the image. The defaults give the fastest results for small images.
+// * clampEveryPixel sends every pixel through the clamped border code, which is how the blurs originally worked. Kept for benchmarking.
+// * tileWidth / tileHeight, when non zero, process the output in tiles of that size instead of whole rows at a time.
+struct BlurOptions
+{
+    bool clampEveryPixel = false;
+    int tileWidth = 0;
+    int tileHeight = 0;
+};
+
+// A box of (2 * radiusX + 1) x (2 * radiusY + 1) pixels centered offsetX, offsetY pixels from the pixel being blurred,
+// for anisotropic blurs like motion blurs. A radius of 0 makes the box a line 1 pixel wide or tall. Offsets can be any
+// size. Boxes are clamped to the image, and a box entirely off the image on an axis covers the edge pixels nearest it.
+struct BlurBox
+{
+    int radiusX = 0;
+    int radiusY = 0;
+    int offsetX = 0;
+    int offsetY = 0;
+};
+
+// Size of cache the tiled blurs aim to fit in. Roughly a per core L2.
+static const int c_blurTileCacheBytes = 256 * 1024;
+
+// Returns a tile width for BlurOptions that keeps the table rows a blur of this radius reuses in cacheBytes
+int BlurTileWidthForCache(int radius, int cacheBytes, int bytesPerEntry);
+
+// Box blurs from the tables into result. The SAT blurs mask table values to numBits and allow wrap around.
+// Scale undoes the scaling of the SAT and AAT variants (see TableVariant).
+void SATBoxBlurBiasedImage(const std::vector<int32>& SAT, int width, int height, int radius, int bias, std::vector<uint8>& result, const BlurOptions& options = BlurOptions());
+void SATBoxBlurImage(const std::vector<uint32>& SAT, int width, int height, int radius, int scale, int numBits, std::vector<uint8>& result, const BlurOptions& options = BlurOptions());
+void AATBoxBlurImage(const std::vector<uint32>& AAT, int width, int height, int radius, int scale, std::vector<uint8>& result, const BlurOptions& options = BlurOptions());
+void AATHalfBoxBlurImage(const std::vector<uint16>& AAT, int width, int height, int radius, std::vector<uint8>& result, const BlurOptions& options = BlurOptions());
+
+// The same blurs reading the table from memory that isn't in a vector, like a memory mapped table file
+void SATBoxBlurBiasedImage(const int32* SAT, int width, int height, int radius, int bias, std::vector<uint8>& result, const BlurOptions& options = BlurOptions());
+void SATBoxBlurImage(const uint32* SAT, int width, int height, int radius, int scale, int numBits, std::vector<uint8>& result, const BlurOptions& options = BlurOptions());
+void SATBoxBlurImage(const uint16* SAT, int width, int height, int radius, int scale, int numBits, std::vector<uint8>& result, const BlurOptions& options = BlurOptions());
+void AATBoxBlurImage(const uint32* AAT, int width, int height, int radius, int scale, std::vector<uint8>& result, const BlurOptions& options = BlurOptions());
+void AATHalfBoxBlurImage(const uint16* AAT, int width, int height, int radius, std::vector<uint8>& result, const BlurOptions& options = BlurOptions());
+
+// The same blurs with a box that can be a different size on each axis and offset from the pixel (see BlurBox). The
+// AAT blur works out each corner's value once and shares it between the two pixels in the row that use it, instead of
+// loading, converting and dividing four corners per pixel. It does that for every box size, and boxes 1 pixel wide or
+// tall don't have a kernel of their own in any of the tables.
+void SATBoxBlurBiasedImage(const std::vector<int32>& SAT, int width, int height, const BlurBox& box, int bias, std::vector<uint8>& result, const BlurOptions& options = BlurOptions());
+void SATBoxBlurImage(const std::vector<uint32>& SAT, int width, int height, const BlurBox& box, int scale, int numBits, std::vector<uint8>& result, const BlurOptions& options = BlurOptions());
+void AATBoxBlurImage(const std::vector<uint32>& AAT, int width, int height, const BlurBox& box, int scale, std::vector<uint8>& result, const BlurOptions& options = BlurOptions());
+void SATBoxBlurBiasedImage(const int32* SAT, int width, int height, const BlurBox& box, int bias, std::vector<uint8>& result, const BlurOptions& options = BlurOptions());
+void SATBoxBlurImage(const uint32* SAT, int width, int height, const BlurBox& box, int scale, int numBits, std::vector<uint8>& result, const BlurOptions& options = BlurOptions());
+void AATBoxBlurImage(const uint32* AAT, int width, int height, const BlurBox& box, int scale, std::vector<uint8>& result, const BlurOptions& options = BlurOptions());
+
+// AAT blurs in integers, for when there's no need to match what a shader would do like AATBoxBlurImage does. Each
+// corner's average times its area gives back a SAT value, and the box sum is divided by the box area with a reciprocal
+// multiply, rounding exactly. AATBoxBlurImage's float math also scales by 255/256, which this doesn't, so it is closer
+// to BoxBlur.
+void AATBoxBlurImageInteger(const std::vector<uint32>& AAT, int width, int height, int radius, int scale, std::vector<uint8>& result, const BlurOptions& options = BlurOptions());
+void AATBoxBlurImageInteger(const uint32* AAT, int width, int height, int radius, int scale, std::vector<uint8>& result, const BlurOptions& options = BlurOptions());
+
+// Blur at several radiuses, writing results[i] for radiuses[i]. Each result is the same as blurring at that radius
+// alone. This is a convenience that orders the work row by row for every radius, so table rows are more likely to
+// still be in the last level cache when the next radius reads them. It shares no loads between radiuses, and isn't
+// faster than a blur per radius when the table fits in cache or the blur is compute bound. options.tileHeight is not
+// used.
+void SATBoxBlurImageMultiRadius(const std::vector<uint32>& SAT, int width, int height, const int* radiuses, int numRadiuses, int scale, int numBits, std::vector<std::vector<uint8>>& results, const BlurOptions& options = BlurOptions());
+void SATBoxBlurBiasedImageMultiRadius(const std::vector<int32>& SAT, int width, int height, const int* radiuses, int numRadiuses, int bias, std::vector<std::vector<uint8>>& results, const BlurOptions& options = BlurOptions());
+void AATBoxBlurImageMultiRadius(const std::vector<uint32>& AAT, int width, int height, const int* radiuses, int numRadiuses, int scale, std::vector<std::vector<uint8>>& results, const BlurOptions& options = BlurOptions());
+
+// Blur where each pixel has its own radius, read from a width x height radius map, like a depth of field circle of
+// confusion. A pixel with a uint8 radius comes out the same as blurring the whole image at that radius. Float radiuses
+// blend the boxes of the whole radiuses either side, so the blur changes smoothly as the radius does. Negative and NaN
+// radiuses are 0. The SAT versions read 32 bit SATs with a scale of 1.
+void SATBoxBlurImageVariableRadius(const std::vector<uint32>& SAT, int width, int height, const uint8* radiusMap, std::vector<uint8>& result);
+void SATBoxBlurImageVariableRadius(const std::vector<uint32>& SAT, int width, int height, const float* radiusMap, std::vector<uint8>& result);
+void AATBoxBlurImageVariableRadius(const std::vector<uint32>& AAT, int width, int height, const uint8* radiusMap, int scale, std::vector<uint8>& result);
+void AATBoxBlurImageVariableRadius(const std::vector<uint32>& AAT, int width, int height, const float* radiusMap, int scale, std::vector<uint8>& result);
+void SATBoxBlurImageVariableRadius(const uint32* SAT, int width, int height, const uint8* radiusMap, std::vector<uint8>& result);
+void SATBoxBlurImageVariableRadius(const uint32* SAT, int width, int height, const float* radiusMap, std::vector<uint8>& result);
+void AATBoxBlurImageVariableRadius(const uint32* AAT, int width, int height, const uint8* radiusMap, int scale, std::vector<uint8>& result);
+void AATBoxBlurImageVariableRadius(const uint32* AAT, int width, int height, const float* radiusMap, int scale, std::vector<uint8>& result);
+
+// Same results as SATBoxBlurImage with a scale of 1 and 32 bits, but reading the SAT from a hierarchical SAT
+void HierarchicalSATBoxBlurImage(const HierarchicalSAT& table, int width, int height, int radius, std::vector<uint8>& result);
+
+// ------------------ Wrap around SATs ------------------
+
+// A SAT that only keeps the low bits it needs for the largest box it will be used with. Box sums come out right
+// through unsigned wrap around as long as the sum fits, so a table for boxes up to maxFilterWidth x maxFilterHeight
+// needs WrapAroundSATBits bits whatever the image size. It is stored as 16 bit when that is enough.
+// Blurs and queries with a bigger box than the table was built for are refused, as their sums would have wrapped.
+struct WrapAroundSAT
+{
+    int width = 0;
+    int height = 0;
+    int maxFilterWidth = 0;
+    int maxFilterHeight = 0;
+    int numBits = 32;
+    std::vector<uint16> values16;   // when numBits <= 16
+    std::vector<uint32> values32;   // otherwise
+};
+
+// Bits needed so 255 * maxFilterWidth * maxFilterHeight doesn't wrap, ceil(log2(255 * w * h + 1))
+int WrapAroundSATBits(int maxFilterWidth, int maxFilterHeight);
+
+// Returns false, leaving the table empty, if the filter size needs more than 32 bits
+bool BuildWrapAroundSAT(const uint8* source, int width, int height, int maxFilterWidth, int maxFilterHeight, WrapAroundSAT& table);
+
+// Same results as SATBoxBlurImage with the full SAT, for radiuses up to the table's maximum filter size. Returns false,
+// leaving result empty, for bigger radiuses.
+bool WrapAroundSATBoxBlurImage(const WrapAroundSAT& table, int radius, std::vector<uint8>& result, const BlurOptions& options = BlurOptions());
+
+// ------------------ Bit packed tables ------------------
+
+// A table that only stores the low numBits bits of each value, packed end to end: value i is at bit i * numBits.
+// A SAT packed to fewer bits than its largest value still gives exact blurs, the same way SATBoxBlurImage's numBits
+// does, as long as each box's sum fits in numBits. A biased SAT has to fit in numBits as a signed value.
+struct PackedTable
+{
+    int width = 0;
+    int height = 0;
+    int numBits = 32;
+    std::vector<uint8> bytes; // padded so that reading 32 bytes from any value's first byte stays in bounds
+};
+
+// Bits needed to store every value of a table, as unsigned or two's complement
+int NumBitsForTable(const uint32* values, size_t count);
+int NumBitsForTable(const int32* values, size_t count);
+
+void PackTable(const uint32* values, int width, int height, int numBits, PackedTable& table);
+void PackTable(const int32* values, int width, int height, int numBits, PackedTable& table);
+
+// Reads count values starting at index. The unsigned version zero extends, the signed version sign extends.
+// Uses AVX2 when available.
+void UnpackTableValues(const PackedTable& table, size_t index, int count, uint32* values);
+void UnpackTableValues(const PackedTable& table, size_t index, int count, int32* values);
+
+// Same results as SATBoxBlurImage (scale 1, table.numBits bits) and SATBoxBlurBiasedImage on the unpacked tables.
+// Interior pixels unpack the two table rows they read and then use the regular kernels.
+void SATBoxBlurPackedImage(const PackedTable& SAT, int radius, std::vector<uint8>& result, const BlurOptions& options = BlurOptions());
+void SATBoxBlurBiasedPackedImage(const PackedTable& SAT, int radius, int bias, std::vector<uint8>& result, const BlurOptions& options = BlurOptions());
+
+// ------------------ Scaled SATs ------------------
+
+// A SAT for boxes between a minimum and maximum size, fit into 16 or 24 bits per texel by dropping low bits and
+// wrapping around at the top, like the SAT 4x / 16x / 256x variants and wrap around SATs combined.
+// * The maximum box size sets how many bits a box sum needs. Anything past storageBits is dropped from the bottom:
+//   values are round(SAT / 2^droppedBits), kept mod 2^storageBits.
+// * Each of the four corners is off by up to half a step, so a box average is off by up to 2 * 2^droppedBits / area
+//   before rounding to 8 bits. The minimum box size is what keeps that small.
+// Border pixels clamp their box to the image, so the smallest box a minimum size filter gives is a corner pixel's
+// ((minFilterWidth + 1) / 2) x ((minFilterHeight + 1) / 2). BuildScaledSAT fails if the bits it has to drop for the
+// largest box leave that box off by more than c_scaledSATMaxError, so every pixel of a blur in the declared sizes is
+// within 1 of SATBoxBlurImage. With no bits dropped the results are the same as SATBoxBlurImage.
+// The blur refuses boxes outside of the declared sizes.
+struct ScaledSAT
+{
+    int width = 0;
+    int height = 0;
+    int minFilterWidth = 0;
+    int minFilterHeight = 0;
+    int maxFilterWidth = 0;
+    int maxFilterHeight = 0;
+    int storageBits = 16;
+    int droppedBits = 0;
+    std::vector<uint16> values16;   // when storageBits is 16
+    PackedTable values24;           // when storageBits is 24
+};
+
+// Low bits to drop so boxes up to maxFilterWidth x maxFilterHeight fit in storageBits
+int ScaledSATDroppedBits(int maxFilterWidth, int maxFilterHeight, int storageBits);
+
+// Largest error BuildScaledSAT allows a box average, in 0 to 255 units, before rounding to 8 bits
+static const double c_scaledSATMaxError = 0.5;
+
+// Area of the smallest box a blur with filters of at least minFilterWidth x minFilterHeight reads, at an image corner
+int ScaledSATSmallestBoxArea(int minFilterWidth, int minFilterHeight);
+
+// Returns false, leaving the table empty, if storageBits can't hold boxes from the minimum to the maximum size
+bool BuildScaledSAT(const uint8* source, int width, int height, int minFilterWidth, int minFilterHeight, int maxFilterWidth, int maxFilterHeight, int storageBits, ScaledSAT& table);
+
+// Largest error of a box average of this area from the table, in 0 to 255 units, before rounding to 8 bits
+double ScaledSATMaxError(const ScaledSAT& table, int boxArea);
+
+// Returns false, leaving result empty, if the box is outside of the table's minimum and maximum filter sizes
+bool ScaledSATBoxBlurImage(const ScaledSAT& table, int radius, std::vector<uint8>& result, const BlurOptions& options = BlurOptions());
+
+// ------------------ RGBA tables ------------------
+
+// How a four channel table is stored.
+// * Interleaved keeps the channels of a texel together, RGBARGBA..., so a corner read brings in all four channels at once.
+// * Planar is four single channel tables one after the other, R then G then B then A.
+enum class ChannelLayout
+{
+    Interleaved,
+    Planar
+};
+
+// Each channel is the same table the single channel functions make from that channel of the interleaved RGBA source.
+// The AAT is rounded, like DitherKind::Round.
+void BuildSATRGBA(const uint8* source, int width, int height, ChannelLayout layout, std::vector<uint32>& SAT);
+void BuildAATRGBA(const std::vector<uint32>& SAT, int width, int height, ChannelLayout layout, int scale, std::vector<uint32>& AAT);
+
+// Box blurs to an interleaved RGBA result. Each channel matches SATBoxBlurImage (scale 1, 32 bits) / AATBoxBlurImage on that channel.
+void SATBoxBlurImageRGBA(const std::vector<uint32>& SAT, int width, int height, ChannelLayout layout, int radius, std::vector<uint8>& result, const BlurOptions& options = BlurOptions());
+void AATBoxBlurImageRGBA(const std::vector<uint32>& AAT, int width, int height, ChannelLayout layout, int radius, int scale, std::vector<uint8>& result, const BlurOptions& options = BlurOptions());
+
+// ------------------ Library API ------------------
+
+// Tables that carry their own size, for code that just wants to build a table and query it.
+// Apart from the table files in TableFile.h, nothing in this library does file I/O or prints; the experiment and
+// benchmarks sit on top of it.
+struct SATTable
+{
+    int width = 0;
+    int height = 0;
+    std::vector<uint32> values;
+};
+
+// values are scale * the average of the rectangle from the origin, rounded or dithered to an integer
+struct AATTable
+{
+    int width = 0;
+    int height = 0;
+    int scale = 1;
+    std::vector<uint32> values;
+};
+
+SATTable BuildSAT(const uint8* source, int width, int height);
+
+// blueNoise is only read for DitherKind::Blue, and must be set for it. White noise comes from an rng seeded with whiteNoiseSeed.
+AATTable BuildAAT(const SATTable& SAT, int scale, DitherKind dither, const NoiseTexture& blueNoise = NoiseTexture(), uint32 whiteNoiseSeed = 0);
+
+template <int Scale, DitherKind Dither = DitherKind::Round>
+AATTable BuildAAT(const SATTable& SAT, const NoiseTexture& blueNoise = NoiseTexture(), uint32 whiteNoiseSeed = 0)
+{
+    static_assert(Scale >= 1 && Scale <= (1 << 24), "AAT values are 255 * Scale and must fit in 32 bits");
+    return BuildAAT(SAT, Scale, Dither, blueNoise, whiteNoiseSeed);
+}
+
+// Average of the pixels in the rectangle from (sx, sy) to (ex, ey) inclusive, in the source's 0 to 255 units.
+// sx <= ex and sy <= ey, which is asserted. The rectangle is clamped to the image, the same as AverageOfRectangle does
+// for the ground truth.
+// The SAT version is exact. The AAT version has the AAT's quantization error, multiplied up by the corners' areas.
+// The wrap around SAT version is exact, and returns NaN if the clamped rectangle is bigger than the table's maximum
+// filter size.
+float QueryBoxAverage(const SATTable& SAT, int sx, int sy, int ex, int ey);
+float QueryBoxAverage(const AATTable& AAT, int sx, int sy, int ex, int ey);
+float QueryBoxAverage(const WrapAroundSAT& table, int sx, int sy, int ex, int ey);
+
+// Many rectangles as a structure of arrays. Each is (sx, sy) to (ex, ey) inclusive, with sx <= ex and sy <= ey,
+// clamped to the image the same as QueryBoxAverage.
+struct BoxQueryList
+{
+    const int32* sx = nullptr;
+    const int32* sy = nullptr;
+    const int32* ex = nullptr;
+    const int32* ey = nullptr;
+    int count = 0;
+};
+
+// * binForLocality sorts the rectangles by which block of the table their bottom right corner is in, and evaluates
+//   them in that order so rectangles reading the same parts of the table run together. The sort costs about as much as
+//   the cache misses it saves on random boxes (see aat_bench), so it is off by default. It can win when the table is
+//   much bigger than the last level cache. Small lists are never binned.
+struct BoxQueryOptions
+{
+    bool binForLocality = false;
+};
+
+static const int c_boxQueryBinMinCount = 16 * 1024;
+
+// Writes the average of each rectangle to averages[index], identical to calling QueryBoxAverage for each one.
+// The work is split across the thread pool, and uses AVX2 gathers when available.
+void QueryBoxAverages(const SATTable& SAT, const BoxQueryList& boxes, float* averages, const BoxQueryOptions& options = BoxQueryOptions());
+void QueryBoxAverages(const AATTable& AAT, const BoxQueryList& boxes, float* averages, const BoxQueryOptions& options = BoxQueryOptions());
@@ -0,0 +1,662 @@
+#include "AAT.h"
+#include "TableFile.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Returns the best of several runs of callback, in nanoseconds per pixel
+template <typename LAMBDA>
+double TimeNanosecondsPerPixel(int width, int height, const LAMBDA& callback)
+{
+    static const int c_numRuns = 5;
+    double best = 0.0;
+    for (int run = 0; run < c_numRuns; ++run)
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        callback();
+        std::chrono::duration<double, std::nano> duration = std::chrono::high_resolution_clock::now() - start;
+        double nsPerPixel = duration.count() / double(width * height);
+        if (run == 0 || nsPerPixel < best)
+            best = nsPerPixel;
+    }
+    return best;
+}
+
+void BenchmarkBorderSplit(const uint8* source, int width, int height)
+{
+    std::vector<uint32> SAT;
+    std::vector<int32> SATBiased127;
+    BuildSATsParallel(source, width, height, SAT, SATBiased127);
+
+    std::vector<uint32> AAT;
+    AAT.resize(width * height);
+    for (int iy = 0; iy < height; ++iy)
+    {
+        for (int ix = 0; ix < width; ++ix)
+            AAT[iy*width + ix] = uint32(0.5f + (double(SAT[iy*width + ix]) / double((ix + 1)*(iy + 1))));
+    }
+
+    printf("Interior / border split, %i x %i, ns per pixel (speedup over clamping every pixel)\n", width, height);
+    printf("radius   SATBiased127           AAT                    SAT                    SAT SIMD\n");
+
+    BlurOptions clamped;
+    clamped.clampEveryPixel = true;
+    BlurOptions split;
+
+    std::vector<uint8> result;
+    int radiuses[] = { 1, 5, 25, 100 };
+    for (int radius : radiuses)
+    {
+        double biasedClamped = TimeNanosecondsPerPixel(width, height, [&]() { SATBoxBlurBiasedImage(SATBiased127, width, height, radius, 127, result, clamped); });
+        double biasedSplit = TimeNanosecondsPerPixel(width, height, [&]() { SATBoxBlurBiasedImage(SATBiased127, width, height, radius, 127, result, split); });
+
+        double AATClamped = TimeNanosecondsPerPixel(width, height, [&]() { AATBoxBlurImage(AAT, width, height, radius, 1, result, clamped); });
+        double AATSplit = TimeNanosecondsPerPixel(width, height, [&]() { AATBoxBlurImage(AAT, width, height, radius, 1, result, split); });
+
+        bool allowSIMD = g_allowSIMD;
+        g_allowSIMD = false;
+        double SATClamped = TimeNanosecondsPerPixel(width, height, [&]() { SATBoxBlurImage(SAT, width, height, radius, 1, 32, result, clamped); });
+        double SATSplit = TimeNanosecondsPerPixel(width, height, [&]() { SATBoxBlurImage(SAT, width, height, radius, 1, 32, result, split); });
+        g_allowSIMD = allowSIMD;
+        double SATSplitSIMD = TimeNanosecondsPerPixel(width, height, [&]() { SATBoxBlurImage(SAT, width, height, radius, 1, 32, result, split); });
+
+        printf("%-8i %5.2f -> %5.2f (%4.2fx)   %5.2f -> %5.2f (%4.2fx)   %5.2f -> %5.2f (%4.2fx)   %5.2f (%4.2fx)\n", radius,
+            biasedClamped, biasedSplit, biasedClamped / biasedSplit,
+            AATClamped, AATSplit, AATClamped / AATSplit,
+            SATClamped, SATSplit, SATClamped / SATSplit,
+            SATSplitSIMD, SATClamped / SATSplitSIMD);
+    }
+}
+
+// Counts L1 data cache read misses and last level cache misses using hardware performance counters.
+// Only available on Linux, and only when the kernel lets us (see /proc/sys/kernel/perf_event_paranoid).
+class CacheMissCounter
+{
+public:
+    CacheMissCounter()
+    {
+#ifdef __linux__
+        m_L1Miss = Open(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+        m_LLCMiss = Open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+#endif
+    }
+
+    ~CacheMissCounter()
+    {
+#ifdef __linux__
+        if (m_L1Miss >= 0)
+            close(m_L1Miss);
+        if (m_LLCMiss >= 0)
+            close(m_LLCMiss);
+#endif
+    }
+
+    bool Available() const { return m_L1Miss >= 0 && m_LLCMiss >= 0; }
+
+    // Runs callback and returns how many L1 and last level cache misses it caused
+    template <typename LAMBDA>
+    void Measure(const LAMBDA& callback, uint64_t& L1Misses, uint64_t& LLCMisses)
+    {
+        L1Misses = 0;
+        LLCMisses = 0;
+        if (!Available())
+        {
+            callback();
+            return;
+        }
+#ifdef __linux__
+        ioctl(m_L1Miss, PERF_EVENT_IOC_RESET, 0);
+        ioctl(m_LLCMiss, PERF_EVENT_IOC_RESET, 0);
+        ioctl(m_L1Miss, PERF_EVENT_IOC_ENABLE, 0);
+        ioctl(m_LLCMiss, PERF_EVENT_IOC_ENABLE, 0);
+        callback();
+        ioctl(m_L1Miss, PERF_EVENT_IOC_DISABLE, 0);
+        ioctl(m_LLCMiss, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(m_L1Miss, &L1Misses, sizeof(L1Misses)) != sizeof(L1Misses))
+            L1Misses = 0;
+        if (read(m_LLCMiss, &LLCMisses, sizeof(LLCMisses)) != sizeof(LLCMisses))
+            LLCMisses = 0;
+#endif
+    }
+
+private:
+#ifdef __linux__
+    static int Open(uint32 type, uint64_t config)
+    {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return int(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+#endif
+
+    int m_L1Miss = -1;
+    int m_LLCMiss = -1;
+};
+
+void BenchmarkTiling(const uint8* source, int sourceWidth, int sourceHeight)
+{
+    // Tiling only matters once table rows stop fitting in cache, so repeat the source image across a wide image
+    static const int c_width = 8192;
+    int width = c_width;
+    int height = sourceHeight;
+    std::vector<uint8> wideSource;
+    wideSource.resize(width * height);
+    for (int iy = 0; iy < height; ++iy)
+    {
+        for (int ix = 0; ix < width; ++ix)
+            wideSource[iy*width + ix] = source[iy*sourceWidth + ix % sourceWidth];
+    }
+
+    std::vector<uint32> SAT;
+    std::vector<int32> SATBiased127;
+    BuildSATsParallel(&wideSource[0], width, height, SAT, SATBiased127);
+
+    std::vector<uint32> AAT;
+    AAT.resize(width * height);
+    for (int iy = 0; iy < height; ++iy)
+    {
+        for (int ix = 0; ix < width; ++ix)
+            AAT[iy*width + ix] = uint32(0.5f + (double(SAT[iy*width + ix]) / double((ix + 1)*(iy + 1))));
+    }
+
+    CacheMissCounter counter;
+
+    printf("\nTiled blurs, %i x %i, ns per pixel [L1 misses, last level cache misses per pixel]\n", width, height);
+    if (!counter.Available())
+        printf("(hardware performance counters not available, cache misses not reported)\n");
+    printf("radius  tile    SAT untiled                  SAT tiled                    AAT untiled                  AAT tiled\n");
+
+    std::vector<uint8> result;
+    int radiuses[] = { 1, 5, 25, 100 };
+    for (int radius : radiuses)
+    {
+        BlurOptions untiled;
+        BlurOptions tiled;
+        tiled.tileWidth = BlurTileWidthForCache(radius, c_blurTileCacheBytes, sizeof(uint32));
+
+        printf("%-7i %-7i", radius, tiled.tileWidth);
+
+        const BlurOptions* optionsList[] = { &untiled, &tiled };
+        for (int technique = 0; technique < 2; ++technique)
+        {
+            for (const BlurOptions* options : optionsList)
+            {
+                std::function<void()> blur;
+                if (technique == 0)
+                    blur = [&]() { SATBoxBlurImage(SAT, width, height, radius, 1, 32, result, *options); };
+                else
+                    blur = [&]() { AATBoxBlurImage(AAT, width, height, radius, 1, result, *options); };
+
+                double nsPerPixel = TimeNanosecondsPerPixel(width, height, blur);
+
+                if (counter.Available())
+                {
+                    uint64_t L1Misses, LLCMisses;
+                    counter.Measure(blur, L1Misses, LLCMisses);
+                    printf(" %5.2f [%6.3f, %6.3f]      ", nsPerPixel, double(L1Misses) / double(width * height), double(LLCMisses) / double(width * height));
+                }
+                else
+                {
+                    printf(" %5.2f [n/a]                ", nsPerPixel);
+                }
+            }
+        }
+        printf("\n");
+    }
+}
+
+void BenchmarkBoxQueries(const uint8* source, int sourceWidth, int sourceHeight)
+{
+    // Binning only matters once the table is bigger than the cache, so repeat the source image across a big image.
+    // A 8192 x 8192 SAT is 256MB.
+    static const int c_size = 8192;
+    static const int c_numBoxes = 4 * 1024 * 1024;
+    static const int c_maxBoxSize = 64;
+
+    std::vector<uint8> bigSource;
+    bigSource.resize(c_size * c_size);
+    for (int iy = 0; iy < c_size; ++iy)
+    {
+        for (int ix = 0; ix < c_size; ++ix)
+            bigSource[iy*c_size + ix] = source[(iy % sourceHeight)*sourceWidth + ix % sourceWidth];
+    }
+
+    SATTable SAT = BuildSAT(&bigSource[0], c_size, c_size);
+    AATTable AAT = BuildAAT<256>(SAT);
+
+    // boxes of random sizes in random places, in no particular order
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<int> position(0, c_size - 1);
+    std::uniform_int_distribution<int> extent(0, c_maxBoxSize - 1);
+    std::vector<int32> sx(c_numBoxes), sy(c_numBoxes), ex(c_numBoxes), ey(c_numBoxes);
+    for (int index = 0; index < c_numBoxes; ++index)
+    {
+        sx[index] = position(rng);
+        sy[index] = position(rng);
+        ex[index] = sx[index] + extent(rng);
+        ey[index] = sy[index] + extent(rng);
+    }
+
+    BoxQueryList boxes;
+    boxes.sx = &sx[0];
+    boxes.sy = &sy[0];
+    boxes.ex = &ex[0];
+    boxes.ey = &ey[0];
+    boxes.count = c_numBoxes;
+
+    std::vector<float> averages(c_numBoxes);
+
+    printf("\nBatched box queries, %i random boxes up to %i x %i on a %i x %i table, ns per box\n", c_numBoxes, c_maxBoxSize, c_maxBoxSize, c_size, c_size);
+    printf("table    scalar   scalar binned   SIMD     SIMD binned\n");
+
+    BoxQueryOptions unbinned;
+    BoxQueryOptions binned;
+    binned.binForLocality = true;
+
+    bool allowSIMD = g_allowSIMD;
+    for (int technique = 0; technique < 2; ++technique)
+    {
+        double nsPerBox[4];
+        for (int test = 0; test < 4; ++test)
+        {
+            g_allowSIMD = allowSIMD && test >= 2;
+            const BoxQueryOptions& options = (test % 2) ? binned : unbinned;
+            // TimeNanosecondsPerPixel divides by width * height, so a 1 x count "image" gives ns per box
+            if (technique == 0)
+                nsPerBox[test] = TimeNanosecondsPerPixel(c_numBoxes, 1, [&]() { QueryBoxAverages(SAT, boxes, &averages[0], options); });
+            else
+                nsPerBox[test] = TimeNanosecondsPerPixel(c_numBoxes, 1, [&]() { QueryBoxAverages(AAT, boxes, &averages[0], options); });
+        }
+        g_allowSIMD = allowSIMD;
+
+        printf("%-8s %-8.2f %-15.2f %-8.2f %-8.2f\n", technique == 0 ? "SAT" : "AAT 256x", nsPerBox[0], nsPerBox[1], nsPerBox[2], nsPerBox[3]);
+    }
+}
+
+void BenchmarkMultiRadius(const uint8* source, int sourceWidth, int sourceHeight)
+{
+    // The multi radius blurs only reorder the work so table rows are still cached for the next radius. That can only
+    // save anything once the table is bigger than the cache, so repeat the source image across a big image. A 8192 x
+    // 8192 SAT is 256MB.
+    static const int c_size = 8192;
+    std::vector<uint8> bigSource;
+    bigSource.resize(size_t(c_size) * size_t(c_size));
+    for (int iy = 0; iy < c_size; ++iy)
+    {
+        for (int ix = 0; ix < c_size; ++ix)
+            bigSource[size_t(iy) * c_size + ix] = source[(iy % sourceHeight) * sourceWidth + ix % sourceWidth];
+    }
+
+    std::vector<uint32> SAT;
+    BuildSATParallel(&bigSource[0], c_size, c_size, SAT);
+
+    CacheMissCounter counter;
+
+    printf("\nMulti radius blurs, %i x %i SAT, ns per pixel for all radiuses (speedup of the row ordered multi radius blur over a blur per radius)\n", c_size, c_size);
+    printf("[last level cache misses per pixel]\n");
+    if (!counter.Available())
+        printf("(hardware performance counters not available, cache misses not reported)\n");
+
+    int radiuses[] = { 1, 2, 4, 8, 16, 32, 64, 100 };
+    std::vector<std::vector<uint8>> results(_countof(radiuses));
+    for (int numRadiuses : { 2, 4, 8 })
+    {
+        std::function<void()> separate = [&]()
+        {
+            for (int index = 0; index < numRadiuses; ++index)
+                SATBoxBlurImage(SAT, c_size, c_size, radiuses[index], 1, 32, results[index]);
+        };
+        std::function<void()> onePass = [&]() { SATBoxBlurImageMultiRadius(SAT, c_size, c_size, radiuses, numRadiuses, 1, 32, results); };
+
+        double separateTime = TimeNanosecondsPerPixel(c_size, c_size, separate);
+        double onePassTime = TimeNanosecondsPerPixel(c_size, c_size, onePass);
+        printf("%i radiuses (1 to %i): %5.2f -> %5.2f (%4.2fx)", numRadiuses, radiuses[numRadiuses - 1], separateTime, onePassTime, separateTime / onePassTime);
+
+        if (counter.Available())
+        {
+            uint64_t L1Misses, separateLLCMisses, onePassLLCMisses;
+            counter.Measure(separate, L1Misses, separateLLCMisses);
+            counter.Measure(onePass, L1Misses, onePassLLCMisses);
+            double pixels = double(c_size) * double(c_size);
+            printf(" [%6.3f -> %6.3f]", double(separateLLCMisses) / pixels, double(onePassLLCMisses) / pixels);
+        }
+        printf("\n");
+    }
+}
+
+void BenchmarkRGBA(const uint8* source, int width, int height)
+{
+    printf("\nRGBA tables, %i x %i, ns per pixel for all four channels (interleaved speedup over planar)\n", width, height);
+
+    std::vector<uint32> SATInterleaved, SATPlanar;
+    double buildInterleaved = TimeNanosecondsPerPixel(width, height, [&]() { BuildSATRGBA(source, width, height, ChannelLayout::Interleaved, SATInterleaved); });
+    double buildPlanar = TimeNanosecondsPerPixel(width, height, [&]() { BuildSATRGBA(source, width, height, ChannelLayout::Planar, SATPlanar); });
+
+    std::vector<uint32> AATInterleaved, AATPlanar;
+    double buildAATInterleaved = TimeNanosecondsPerPixel(width, height, [&]() { BuildAATRGBA(SATInterleaved, width, height, ChannelLayout::Interleaved, 256, AATInterleaved); });
+    double buildAATPlanar = TimeNanosecondsPerPixel(width, height, [&]() { BuildAATRGBA(SATPlanar, width, height, ChannelLayout::Planar, 256, AATPlanar); });
+
+    printf("build    SAT %5.2f -> %5.2f (%4.2fx)   AAT %5.2f -> %5.2f (%4.2fx)\n",
+        buildPlanar, buildInterleaved, buildPlanar / buildInterleaved,
+        buildAATPlanar, buildAATInterleaved, buildAATPlanar / buildAATInterleaved);
+
+    printf("radius   SAT planar -> interleaved     AAT planar -> interleaved\n");
+
+    std::vector<uint8> result;
+    int radiuses[] = { 1, 5, 25, 100 };
+    for (int radius : radiuses)
+    {
+        double SATPlanarBlur = TimeNanosecondsPerPixel(width, height, [&]() { SATBoxBlurImageRGBA(SATPlanar, width, height, ChannelLayout::Planar, radius, result); });
+        double SATInterleavedBlur = TimeNanosecondsPerPixel(width, height, [&]() { SATBoxBlurImageRGBA(SATInterleaved, width, height, ChannelLayout::Interleaved, radius, result); });
+        double AATPlanarBlur = TimeNanosecondsPerPixel(width, height, [&]() { AATBoxBlurImageRGBA(AATPlanar, width, height, ChannelLayout::Planar, radius, 256, result); });
+        double AATInterleavedBlur = TimeNanosecondsPerPixel(width, height, [&]() { AATBoxBlurImageRGBA(AATInterleaved, width, height, ChannelLayout::Interleaved, radius, 256, result); });
+
+        printf("%-8i %5.2f -> %5.2f (%4.2fx)        %5.2f -> %5.2f (%4.2fx)\n", radius,
+            SATPlanarBlur, SATInterleavedBlur, SATPlanarBlur / SATInterleavedBlur,
+            AATPlanarBlur, AATInterleavedBlur, AATPlanarBlur / AATInterleavedBlur);
+    }
+}
+
+void BenchmarkTableFile(const uint8* source, int sourceWidth, int sourceHeight)
+{
+    // Big enough that building the table is a noticeable part of startup
+    static const int c_size = 4096;
+    static const int c_radius = 5;
+    static const char* c_fileName = "aat_bench_table.tmp";
+
+    std::vector<uint8> bigSource;
+    bigSource.resize(c_size * c_size);
+    for (int iy = 0; iy < c_size; ++iy)
+    {
+        for (int ix = 0; ix < c_size; ++ix)
+            bigSource[iy*c_size + ix] = source[(iy % sourceHeight)*sourceWidth + ix % sourceWidth];
+    }
+
+    std::vector<uint32> SAT;
+    BuildSATParallel(&bigSource[0], c_size, c_size, SAT);
+
+    TableFileHeader header;
+    header.kind = TableKind::SAT;
+    header.width = c_size;
+    header.height = c_size;
+    if (!WriteTableFile(c_fileName, header, &SAT[0]))
+    {
+        printf("\nCould not write %s, skipping the table file benchmark\n", c_fileName);
+        return;
+    }
+
+    printf("\nTable startup, %i x %i SAT then a radius %i blur, ns per pixel\n", c_size, c_size, c_radius);
+    printf("(the file was just written so it is in the OS file cache, which is the case a batch job reusing tables sees)\n");
+
+    std::vector<uint8> result;
+    double build = TimeNanosecondsPerPixel(c_size, c_size, [&]()
+    {
+        std::vector<uint32> builtSAT;
+        BuildSATParallel(&bigSource[0], c_size, c_size, builtSAT);
+        SATBoxBlurImage(builtSAT, c_size, c_size, c_radius, 1, 32, result);
+    });
+
+    bool mapped = true;
+    double map = TimeNanosecondsPerPixel(c_size, c_size, [&]()
+    {
+        MappedTableFile file;
+        mapped = mapped && file.Open(c_fileName) && file.UInt32Values();
+        if (mapped)
+            SATBoxBlurImage(file.UInt32Values(), file.Header().width, file.Header().height, c_radius, 1, 32, result);
+    });
+
+    if (mapped)
+        printf("build + blur %5.2f   map + blur %5.2f (%4.2fx)\n", build, map, build / map);
+    else
+        printf("Could not map %s\n", c_fileName);
+
+    remove(c_fileName);
+}
+
+void BenchmarkPacking(const uint8* source, int width, int height)
+{
+    std::vector<uint32> SAT;
+    std::vector<int32> SATBiased127;
+    BuildSATsParallel(source, width, height, SAT, SATBiased127);
+
+    int SATBits = NumBitsForTable(&SAT[0], SAT.size());
+    int biasedBits = NumBitsForTable(&SATBiased127[0], SATBiased127.size());
+
+    printf("\nBit packed SATs, %i x %i, ns per pixel (packed / unpacked time). Sums of boxes up to radius 25 fit in 20 bits.\n", width, height);
+    printf("table         bits  KB       pack     radius 1               radius 5               radius 25\n");
+
+    std::vector<uint8> result;
+    int radiuses[] = { 1, 5, 25 };
+    int bitCounts[] = { 32, SATBits, 24, 20 };
+    for (int technique = 0; technique < 2; ++technique)
+    {
+        for (int numBits : bitCounts)
+        {
+            // the biased SAT has to fit, so only gets its own size
+            if (technique == 1 && numBits != 32 && numBits != SATBits)
+                continue;
+            if (technique == 1 && numBits == SATBits)
+                numBits = biasedBits;
+
+            PackedTable packed;
+            double pack;
+            if (technique == 0)
+                pack = TimeNanosecondsPerPixel(width, height, [&]() { PackTable(&SAT[0], width, height, numBits, packed); });
+            else
+                pack = TimeNanosecondsPerPixel(width, height, [&]() { PackTable(&SATBiased127[0], width, height, numBits, packed); });
+
+            printf("%-13s %-5i %-8i %5.2f   ", technique == 0 ? "SAT" : "SATBiased127", numBits, int(packed.bytes.size() / 1024), pack);
+
+            for (int radius : radiuses)
+            {
+                double packedTime, unpackedTime;
+                if (technique == 0)
+                {
+                    packedTime = TimeNanosecondsPerPixel(width, height, [&]() { SATBoxBlurPackedImage(packed, radius, result); });
+                    unpackedTime = TimeNanosecondsPerPixel(width, height, [&]() { SATBoxBlurImage(SAT, width, height, radius, 1, numBits, result); });
+                }
+                else
+                {
+                    packedTime = TimeNanosecondsPerPixel(width, height, [&]() { SATBoxBlurBiasedPackedImage(packed, radius, 127, result); });
+                    unpackedTime = TimeNanosecondsPerPixel(width, height, [&]() { SATBoxBlurBiasedImage(SATBiased127, width, height, radius, 127, result); });
+                }
+                printf("%5.2f / %5.2f (%4.2fx)  ", packedTime, unpackedTime, packedTime / unpackedTime);
+            }
+            printf("\n");
+        }
+    }
+}
+
+void BenchmarkAATInteger(const uint8* source, int width, int height)
+{
+    std::vector<uint32> SAT;
+    BuildSATParallel(source, width, height, SAT);
+
+    printf("\nAAT blurs in float vs integers, %i x %i, ns per pixel (speedup) and mean absolute error vs BoxBlur\n", width, height);
+    printf("scale  radius   float   integer          float error  integer error\n");
+
+    NoiseTexture noNoise;
+    std::vector<uint32> AAT;
+    std::vector<uint8> groundTruth, result;
+    int scales[] = { 1, 16, 256 };
+    int radiuses[] = { 1, 5, 25, 100 };
+    for (int scale : scales)
+    {
+        BuildTableVariant(SAT, width, height, { TableKind::AAT, DitherKind::Round, scale, "AAT" }, noNoise, 0, AAT);
+        for (int radius : radiuses)
+        {
+            BoxBlurSlidingWindow(source, width, height, radius, groundTruth);
+
+            double floatTime = TimeNanosecondsPerPixel(width, height, [&]() { AATBoxBlurImage(AAT, width, height, radius, scale, result); });
+            double floatError = CompareToGroundTruth(groundTruth, result).meanAbsolute;
+
+            double integerTime = TimeNanosecondsPerPixel(width, height, [&]() { AATBoxBlurImageInteger(AAT, width, height, radius, scale, result); });
+            double integerError = CompareToGroundTruth(groundTruth, result).meanAbsolute;
+
+            printf("%-6i %-8i %5.2f   %5.2f (%4.2fx)    %9.4f    %9.4f\n", scale, radius, floatTime, integerTime, floatTime / integerTime, floatError, integerError);
+        }
+    }
+}
+
+void BenchmarkVariableRadius(const uint8* source, int width, int height)
+{
+    // A depth of field like radius map, in focus across the middle row and blurring up to 24 towards the top and bottom.
+    // The noisy map jitters each pixel's radius, so the radius changes every pixel and the blurs have to bucket them.
+    static const float c_maxRadius = 24.0f;
+    std::mt19937 rng(0);
+    std::vector<float> radiusMapFloat(width * height);
+    std::vector<uint8> radiusMap(width * height);
+    std::vector<uint8> radiusMapNoisy(width * height);
+    for (int iy = 0; iy < height; ++iy)
+    {
+        for (int ix = 0; ix < width; ++ix)
+        {
+            float radius = c_maxRadius * std::abs(float(iy) / float(height - 1) * 2.0f - 1.0f);
+            radiusMapFloat[iy*width + ix] = radius;
+            radiusMap[iy*width + ix] = uint8(radius + 0.5f);
+            radiusMapNoisy[iy*width + ix] = uint8(std::max(int(radius + 0.5f) + int(rng() % 5) - 2, 0));
+        }
+    }
+
+    std::vector<uint32> SAT;
+    BuildSATParallel(source, width, height, SAT);
+
+    NoiseTexture noNoise;
+    std::vector<uint32> AAT;
+    BuildTableVariant(SAT, width, height, { TableKind::AAT, DitherKind::Round, 256, "AAT" }, noNoise, 0, AAT);
+
+    printf("\nVariable radius blurs, %i x %i, radius 0 to %i, ns per pixel scalar -> SIMD (speedup)\n", width, height, int(c_maxRadius));
+    printf("table  fixed radius %-2i       uint8 radius map      float radius map      noisy uint8 radius map\n", int(c_maxRadius) / 2);
+
+    std::vector<uint8> result;
+    bool allowSIMD = g_allowSIMD;
+    for (bool isAAT : { false, true })
+    {
+        std::function<void()> tests[4];
+        if (isAAT)
+        {
+            tests[0] = [&]() { AATBoxBlurImage(AAT, width, height, int(c_maxRadius) / 2, 256, result); };
+            tests[1] = [&]() { AATBoxBlurImageVariableRadius(AAT, width, height, &radiusMap[0], 256, result); };
+            tests[2] = [&]() { AATBoxBlurImageVariableRadius(AAT, width, height, &radiusMapFloat[0], 256, result); };
+            tests[3] = [&]() { AATBoxBlurImageVariableRadius(AAT, width, height, &radiusMapNoisy[0], 256, result); };
+        }
+        else
+        {
+            tests[0] = [&]() { SATBoxBlurImage(SAT, width, height, int(c_maxRadius) / 2, 1, 32, result); };
+            tests[1] = [&]() { SATBoxBlurImageVariableRadius(SAT, width, height, &radiusMap[0], result); };
+            tests[2] = [&]() { SATBoxBlurImageVariableRadius(SAT, width, height, &radiusMapFloat[0], result); };
+            tests[3] = [&]() { SATBoxBlurImageVariableRadius(SAT, width, height, &radiusMapNoisy[0], result); };
+        }
+
+        printf("%-6s", isAAT ? "AAT" : "SAT");
+        for (const std::function<void()>& test : tests)
+        {
+            g_allowSIMD = false;
+            double scalarTime = TimeNanosecondsPerPixel(width, height, test);
+            g_allowSIMD = allowSIMD;
+            double SIMDTime = TimeNanosecondsPerPixel(width, height, test);
+            printf(" %5.2f -> %5.2f (%4.2fx)", scalarTime, SIMDTime, scalarTime / SIMDTime);
+        }
+        printf("\n");
+    }
+}
+
+void BenchmarkAnisotropic(const uint8* source, int width, int height)
+{
+    // Motion blur like boxes. No table has a kernel of its own for boxes 1 pixel wide or tall. They go through the same
+    // interior kernels as any other box, which for AATs is the one that shares corner values.
+    static const BlurBox c_boxes[] = { { 12, 12 }, { 25, 0 }, { 0, 25 }, { 25, 4 }, { 25, 0, 25, 0 } };
+
+    std::vector<uint32> SAT;
+    std::vector<int32> SATBiased127;
+    BuildSATsParallel(source, width, height, SAT, SATBiased127);
+
+    NoiseTexture noNoise;
+    std::vector<uint32> AAT;
+    BuildTableVariant(SAT, width, height, { TableKind::AAT, DitherKind::Round, 256, "AAT" }, noNoise, 0, AAT);
+
+    printf("\nAnisotropic box blurs, %i x %i, ns per pixel\n", width, height);
+    printf("table     ");
+    for (const BlurBox& box : c_boxes)
+    {
+        char name[32];
+        sprintf_s(name, "%ix%i%s", box.radiusX * 2 + 1, box.radiusY * 2 + 1, (box.offsetX || box.offsetY) ? " offset" : "");
+        printf(" %-11s", name);
+    }
+    printf("\n");
+
+    std::vector<uint8> result;
+    for (int table = 0; table < 3; ++table)
+    {
+        printf("%-10s", table == 0 ? "SAT" : table == 1 ? "SATBiased" : "AAT");
+        for (const BlurBox& box : c_boxes)
+        {
+            double time = TimeNanosecondsPerPixel(width, height, [&]()
+                {
+                    if (table == 0)
+                        SATBoxBlurImage(SAT, width, height, box, 1, 32, result);
+                    else if (table == 1)
+                        SATBoxBlurBiasedImage(SATBiased127, width, height, box, 127, result);
+                    else
+                        AATBoxBlurImage(AAT, width, height, box, 256, result);
+                }
+            );
+            printf(" %-11.2f", time);
+        }
+        printf("\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    for (int index = 1; index < argc; ++index)
+    {
+        if (!strcmp(argv[index], "-nosimd"))
+            g_allowSIMD = false;
+        else if (!strncmp(argv[index], "-threads=", 9))
+            g_numThreads = atoi(&argv[index][9]);
+    }
+
+    int width, height, components;
+    stbi_uc* pixels = stbi_load("scenery.png", &width, &height, &components, 1);
+    if (!pixels)
+    {
+        printf("Could not load scenery.png. Run from the directory it is in.\n");
+        return 1;
+    }
+
+    BenchmarkBorderSplit(pixels, width, height);
+    BenchmarkTiling(pixels, width, height);
+    BenchmarkBoxQueries(pixels, width, height);
+    BenchmarkTableFile(pixels, width, height);
+    BenchmarkPacking(pixels, width, height);
+    BenchmarkAATInteger(pixels, width, height);
+    BenchmarkMultiRadius(pixels, width, height);
+    BenchmarkVariableRadius(pixels, width, height);
+    BenchmarkAnisotropic(pixels, width, height);
+
+    stbi_uc* pixelsRGBA = stbi_load("scenery.png", &width, &height, &components, 4);
+    BenchmarkRGBA(pixelsRGBA, width, height);
+
+    stbi_image_free(pixelsRGBA);
+    stbi_image_free(pixels);
+    return 0;
+}
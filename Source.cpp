@@ -1,283 +1,671 @@
-#include <stdio.h>
+#include "AAT.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include <random>
+#include <memory>
+#include <string>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#ifdef _MSC_VER
 #define STBI_MSC_SECURE_CRT
+#endif
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 
-typedef uint8_t uint8;
-typedef uint16_t uint16;
-typedef uint32_t uint32;
-typedef int32_t int32;
+NoiseTexture g_blueNoise;
 
-int g_blueNoiseWidth, g_blueNoiseHeight, g_blueNoiseChannels;
-stbi_uc* g_blueNoisePixels = nullptr;
-
-template <typename T>
-float AverageOfRectangle(T* data, int width, int height, int sx, int sy, int ex, int ey)
+// How BoxBlur computes its ground truth.
+// * SlidingWindow keeps a running sum per row / column so costs O(1) per pixel regardless of radius.
+// * Reference is the original brute force AverageOfRectangle ping/pong, O(radius) per pixel.
+// * Validate runs both and reports any pixels that differ. They should be bit identical.
+enum class BoxBlurMode
+{
+    SlidingWindow,
+    Reference,
+    Validate
+};
+
+BoxBlurMode g_boxBlurMode = BoxBlurMode::SlidingWindow;
+
+// Encodes and writes PNGs on background threads so the blurs don't wait on zlib and the disk.
+// Finished images go in a bounded queue. When the queue is full, Write blocks until an encoder thread makes room, which
+// keeps the memory held by pending images bounded. Flush waits until everything queued so far is on disk.
+// With zero encoder threads, Write encodes and writes immediately on the calling thread.
+class PNGWriter
 {
-    sx = std::min(std::max(sx, 0), width - 1);
-    ex = std::min(std::max(ex, 0), width - 1);
-    sy = std::min(std::max(sy, 0), height - 1);
-    ey = std::min(std::max(ey, 0), height - 1);
+public:
+    PNGWriter(int numThreads, int maxQueued)
+        : m_maxQueued(std::max(maxQueued, 1))
+    {
+        for (int index = 0; index < numThreads; ++index)
+            m_threads.emplace_back([this]() { EncoderThread(); });
+    }
 
-    float sum = 0.0f;
-    for (int iy = sy; iy <= ey; ++iy)
+    ~PNGWriter()
     {
-        for (int ix = sx; ix <= ex; ++ix)
+        Flush();
         {
-            sum += float(data[iy*width+ix]);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_exiting = true;
         }
+        m_queueChanged.notify_all();
+        for (std::thread& thread : m_threads)
+            thread.join();
     }
 
-    float sampleCount = float(ey - sy + 1)*float(ex - sx + 1);
+    void Write(const char* fileName, int width, int height, std::vector<uint8>&& pixels)
+    {
+        Image image{ fileName, width, height, std::move(pixels) };
 
-    return sum / sampleCount;
-}
+        if (m_threads.empty())
+        {
+            Encode(image);
+            return;
+        }
 
-void BoxBlur(const uint8* source, int width, int height, int radius, const char* baseFileName)
-{
-	std::vector<uint8> resultPing;
-    std::vector<uint8> resultPong;
-	resultPing.resize(width * height);
-    resultPong.resize(width * height);
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_queueChanged.wait(lock, [this]() { return int(m_queue.size()) < m_maxQueued; });
+        m_queue.push_back(std::move(image));
+        lock.unlock();
+        m_queueChanged.notify_all();
+    }
 
-    float filterSize = float(radius * 2 + 1);
+    void Flush()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_queueChanged.wait(lock, [this]() { return m_queue.empty() && m_numEncoding == 0; });
+    }
 
-    // horizontal blur from source to ping
-    for (int iy = 0; iy < height; ++iy)
+private:
+    struct Image
     {
-        for (int ix = 0; ix < width; ++ix)
-        {
-            float average = AverageOfRectangle(source, width, height, ix - radius, iy, ix + radius, iy);
-            resultPing[iy*width + ix] = uint8(0.5f + average);
-        }
+        std::string fileName;
+        int width;
+        int height;
+        std::vector<uint8> pixels;
+    };
+
+    static void Encode(const Image& image)
+    {
+        printf("%s\n", image.fileName.c_str());
+        stbi_write_png(image.fileName.c_str(), image.width, image.height, 1, &image.pixels[0], image.width);
     }
 
-    // vertical blur from ping to pong
-    for (int iy = 0; iy < height; ++iy)
+    void EncoderThread()
     {
-        for (int ix = 0; ix < width; ++ix)
+        while (true)
         {
-            float average = AverageOfRectangle(&resultPing[0], width, height, ix, iy - radius, ix, iy + radius);
-            resultPong[iy*width + ix] = uint8(0.5f + average);
+            Image image;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_queueChanged.wait(lock, [this]() { return m_exiting || !m_queue.empty(); });
+                if (m_queue.empty())
+                    return;
+                image = std::move(m_queue.front());
+                m_queue.pop_front();
+                m_numEncoding++;
+            }
+            m_queueChanged.notify_all();
+
+            Encode(image);
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_numEncoding--;
+            }
+            m_queueChanged.notify_all();
         }
     }
 
-    char append[32];
-    sprintf_s(append, "_%i", radius);
+    std::vector<std::thread> m_threads;
+    std::deque<Image> m_queue;
+    std::mutex m_mutex;
+    std::condition_variable m_queueChanged;
+    int m_maxQueued;
+    int m_numEncoding = 0;
+    bool m_exiting = false;
+};
+
+// -1 means pick based on core count. 0 means write PNGs synchronously. Set from the command line before first use.
+int g_numPNGThreads = -1;
+
+int NumPNGThreads()
+{
+    if (g_numPNGThreads >= 0)
+        return g_numPNGThreads;
+    return std::max(int(std::thread::hardware_concurrency()) / 4, 1);
+}
+
+PNGWriter& GetPNGWriter()
+{
+    static PNGWriter writer(NumPNGThreads(), NumPNGThreads() * 4);
+    return writer;
+}
+
+void WriteBlurPNG(std::vector<uint8>&& result, int width, int height, const char* baseFileName, const char* append)
+{
     char fileName[256];
     sprintf_s(fileName, baseFileName, append);
-    printf("%s\n", fileName);
-    stbi_write_png(fileName, width, height, 1, &resultPong[0], width);
+    GetPNGWriter().Write(fileName, width, height, std::move(result));
 }
 
-void SATBoxBlurBiased(const std::vector<int32>& SAT, int width, int height, int radius, const char* baseFileName, const char* technique, int bias)
+void BoxBlur(const uint8* source, int width, int height, int radius, const char* baseFileName)
 {
-	std::vector<uint8> result;
-	result.resize(SAT.size());
+    std::vector<uint8> result;
 
-	for (int iy = 0; iy < height; ++iy)
-	{
-		for (int ix = 0; ix < width; ++ix)
-		{
-			int startX = std::max(ix - radius - 1, -1);
-			int startY = std::max(iy - radius - 1, -1);
+    switch (g_boxBlurMode)
+    {
+        case BoxBlurMode::SlidingWindow:
+        {
+            BoxBlurSlidingWindow(source, width, height, radius, result);
+            break;
+        }
+        case BoxBlurMode::Reference:
+        {
+            BoxBlurReference(source, width, height, radius, result);
+            break;
+        }
+        case BoxBlurMode::Validate:
+        {
+            std::vector<uint8> reference;
+            BoxBlurReference(source, width, height, radius, reference);
+            BoxBlurSlidingWindow(source, width, height, radius, result);
+
+            size_t mismatches = 0;
+            for (size_t index = 0; index < result.size(); ++index)
+            {
+                if (result[index] != reference[index])
+                    mismatches++;
+            }
+            printf("BoxBlur validation (radius %i): %zu mismatched pixels\n", radius, mismatches);
+            break;
+        }
+    }
 
-			int endX = std::min(ix + radius, width - 1);
-			int endY = std::min(iy + radius, height - 1);
+    char append[32];
+    sprintf_s(append, "_%i", radius);
+    WriteBlurPNG(std::move(result), width, height, baseFileName, append);
+}
 
-			int32 A = (startX >= 0 && startY >= 0) ? SAT[startY*width + startX] : bias;
-			int32 B = (startY >= 0) ? SAT[startY*width + endX] : -bias;
-			int32 C = (startX >= 0) ? SAT[endY*width + startX] : -bias;
-			int32 D = SAT[endY*width + endX];
+// When true, the experiment's blurs use cache sized tiles
+bool g_tiledBlurs = false;
 
-			int32 integratedValue = (A + D - B - C);
+BlurOptions DefaultBlurOptions(int radius)
+{
+    BlurOptions options;
+    if (g_tiledBlurs)
+        options.tileWidth = BlurTileWidthForCache(radius, c_blurTileCacheBytes, sizeof(uint32));
+    return options;
+}
 
-			double size = double((endY - startY)*(endX - startX));
+void SATBoxBlur(const std::vector<uint32>& SAT, int width, int height, int radius, const char* baseFileName, const char* technique, int scale, int numBits)
+{
+	std::vector<uint8> result;
+	SATBoxBlurImage(SAT, width, height, radius, scale, numBits, result, DefaultBlurOptions(radius));
 
-			uint8 average = uint8(float(bias) + 0.5f + double(integratedValue) / size);
+    char append[64];
+    sprintf_s(append, "_%i_%s_%ix", radius, technique, scale);
+    WriteBlurPNG(std::move(result), width, height, baseFileName, append);
+}
 
-			result[iy*width + ix] = average;
-		}
-	}
+void WrapAroundSATBoxBlur(const WrapAroundSAT& table, int radius, const char* baseFileName, const char* technique)
+{
+	std::vector<uint8> result;
+	if (!WrapAroundSATBoxBlurImage(table, radius, result, DefaultBlurOptions(radius)))
+		return;
 
     char append[64];
-    sprintf_s(append, "_%i_%s", radius, technique);
-
-	char fileName[256];
-	sprintf_s(fileName, baseFileName, append);
-    printf("%s\n", fileName);
-	stbi_write_png(fileName, width, height, 1, &result[0], width);
+    sprintf_s(append, "_%i_%s_%ibit", radius, technique, table.numBits);
+    WriteBlurPNG(std::move(result), table.width, table.height, baseFileName, append);
 }
 
-void SATBoxBlur(const std::vector<uint32>& SAT, int width, int height, int radius, const char* baseFileName, const char* technique, int scale, int numBits)
+void HierarchicalSATBoxBlur(const HierarchicalSAT& table, int width, int height, int radius, const char* baseFileName, const char* technique)
 {
 	std::vector<uint8> result;
-	result.resize(SAT.size());
+	HierarchicalSATBoxBlurImage(table, width, height, radius, result);
 
-	uint32 maxValue = numBits == 32 ? uint32(-1) : uint32(1 << numBits) - 1;
+	char append[64];
+    sprintf_s(append, "_%i_%s", radius, technique);
+    WriteBlurPNG(std::move(result), width, height, baseFileName, append);
+}
 
-	for (int iy = 0; iy < height; ++iy)
-	{
-		for (int ix = 0; ix < width; ++ix)
-		{
-			if (ix > 3 && iy > 3)
-			{
-				int ijkl = 0;
-				(void)ijkl;
-			}
-
-			int startX = std::max(ix - radius - 1, -1);
-			int startY = std::max(iy - radius - 1, -1);
-
-			int endX = std::min(ix + radius, width - 1);
-			int endY = std::min(iy + radius, height - 1);
-
-			uint32 A = (startX >= 0 && startY >= 0) ? SAT[startY*width + startX] : 0;
-			uint32 B = (startY >= 0) ? SAT[startY*width + endX] : 0;
-			uint32 C = (startX >= 0) ? SAT[endY*width + startX] : 0;
-			uint32 D = SAT[endY*width + endX];
-
-			A &= maxValue;
-			B &= maxValue;
-			C &= maxValue;
-			D &= maxValue;
-
-			// TODO: should we do it as float? i feel like "yes" because shaders will do that, but i don't think the wrap around works there? dunno...
-#if 0
-			// Note that double can perfectly represent any uint32, but it's a float when a shader gets it
-			float fA = float(double(A) / double(maxValue));
-			float fB = float(double(B) / double(maxValue));
-			float fC = float(double(C) / double(maxValue));
-			float fD = float(double(D) / double(maxValue));
-
-			fA *= float(scale);
-			fB *= float(scale);
-			fC *= float(scale);
-			fD *= float(scale);
-
-			float integratedValue = fA + fD - fB - fC;
-
-			float size = float((endY - startY)*(endX - startX));
-
-			uint8 average = uint8(0.5 + double(maxValue) * double(integratedValue / size));
-#else
-			uint32 integratedValue = A + D - B - C;
-			integratedValue *= scale;
-			integratedValue &= maxValue;
-
-			float size = float((endY - startY)*(endX - startX));
-
-			uint8 average = uint8(0.5 + double(integratedValue) / double(size));
-#endif
+// Blurs at every radius, writing a file per radius
+void SATBoxBlurBiasedMultiRadius(const std::vector<int32>& SAT, int width, int height, const int* radiuses, int numRadiuses, const char* baseFileName, const char* technique, int bias)
+{
+    std::vector<std::vector<uint8>> results;
+    SATBoxBlurBiasedImageMultiRadius(SAT, width, height, radiuses, numRadiuses, bias, results, DefaultBlurOptions(radiuses[numRadiuses - 1]));
 
-			result[iy*width + ix] = average;
-		}
-	}
+    for (int index = 0; index < numRadiuses; ++index)
+    {
+        char append[64];
+        sprintf_s(append, "_%i_%s", radiuses[index], technique);
+        WriteBlurPNG(std::move(results[index]), width, height, baseFileName, append);
+    }
+}
 
-    char append[64];
-    sprintf_s(append, "_%i_%s_%ix", radius, technique, scale);
+void SATBoxBlurMultiRadius(const std::vector<uint32>& SAT, int width, int height, const int* radiuses, int numRadiuses, const char* baseFileName, const char* technique, int scale, int numBits)
+{
+    std::vector<std::vector<uint8>> results;
+    SATBoxBlurImageMultiRadius(SAT, width, height, radiuses, numRadiuses, scale, numBits, results, DefaultBlurOptions(radiuses[numRadiuses - 1]));
 
-	char fileName[256];
-	sprintf_s(fileName, baseFileName, append);
-    printf("%s\n", fileName);
-	stbi_write_png(fileName, width, height, 1, &result[0], width);
+    for (int index = 0; index < numRadiuses; ++index)
+    {
+        char append[64];
+        sprintf_s(append, "_%i_%s_%ix", radiuses[index], technique, scale);
+        WriteBlurPNG(std::move(results[index]), width, height, baseFileName, append);
+    }
 }
 
-void AATBoxBlur(const std::vector<uint32>& AAT, int width, int height, int radius, const char* baseFileName, const char* technique, int scale)
+void AATBoxBlurMultiRadius(const std::vector<uint32>& AAT, int width, int height, const int* radiuses, int numRadiuses, const char* baseFileName, const char* technique, int scale)
+{
+    std::vector<std::vector<uint8>> results;
+    AATBoxBlurImageMultiRadius(AAT, width, height, radiuses, numRadiuses, scale, results, DefaultBlurOptions(radiuses[numRadiuses - 1]));
+
+    for (int index = 0; index < numRadiuses; ++index)
+    {
+        char append[64];
+        sprintf_s(append, "_%i_%s_%ix", radiuses[index], technique, scale);
+        WriteBlurPNG(std::move(results[index]), width, height, baseFileName, append);
+    }
+}
+
+void AATHalfBoxBlur(const std::vector<uint16>& AAT, int width, int height, int radius, const char* baseFileName, const char* technique)
 {
 	std::vector<uint8> result;
-	result.resize(AAT.size());
+	AATHalfBoxBlurImage(AAT, width, height, radius, result, DefaultBlurOptions(radius));
 
-	for (int iy = 0; iy < height; ++iy)
-	{
-		for (int ix = 0; ix < width; ++ix)
-		{
-			int startX = std::max(ix - radius - 1, -1);
-			int startY = std::max(iy - radius - 1, -1);
+	char append[64];
+    sprintf_s(append, "_%i_%s", radius, technique);
+    WriteBlurPNG(std::move(result), width, height, baseFileName, append);
+}
 
-			int endX = std::min(ix + radius, width - 1);
-			int endY = std::min(iy + radius, height - 1);
+// Most table variants alive at once. Each is a full table, so this bounds the experiment's peak memory no matter how
+// many workers the pool has. Set from the command line with -maxtables=N.
+int g_maxLiveTables = 2;
 
-            // This function aims to mimic unorm and shader behaviors.
-            // * Scale implicitly describes the number of bits of storage above 8. (eg 10 bit would have a scale of 4)
-            // * It converts to float because that's what shaders work in.
-            // * It multiplies by area after converting to float because that's when shaders would be able to do their work to turn an average back into an area.
+static const TableVariant c_tableVariants[] =
+{
+    // SATs. The plain 1x SAT is the full precision SAT itself so isn't in this list.
+    { TableKind::SAT, DitherKind::Round, 4, "SAT" },
+    { TableKind::SAT, DitherKind::Round, 16, "SAT" },
+    { TableKind::SAT, DitherKind::Round, 256, "SAT" },
+    { TableKind::SAT, DitherKind::White, 4, "SATWhite" },
+    { TableKind::SAT, DitherKind::White, 16, "SATWhite" },
+    { TableKind::SAT, DitherKind::White, 256, "SATWhite" },
+    { TableKind::SAT, DitherKind::Blue, 4, "SATBlue" },
+    { TableKind::SAT, DitherKind::Blue, 16, "SATBlue" },
+    { TableKind::SAT, DitherKind::Blue, 256, "SATBlue" },
+
+    // AATs. Scales of 4, 16 and 256 are an extra 2, 4 and 8 bits of precision (10, 12 and 16 bit unorm).
+    { TableKind::AAT, DitherKind::Round, 1, "AAT" },
+    { TableKind::AAT, DitherKind::Round, 4, "AAT" },
+    { TableKind::AAT, DitherKind::Round, 16, "AAT" },
+    { TableKind::AAT, DitherKind::Round, 256, "AAT" },
+    { TableKind::AAT, DitherKind::White, 1, "AATWhite" },
+    { TableKind::AAT, DitherKind::White, 4, "AATWhite" },
+    { TableKind::AAT, DitherKind::White, 16, "AATWhite" },
+    { TableKind::AAT, DitherKind::White, 256, "AATWhite" },
+    { TableKind::AAT, DitherKind::Blue, 1, "AATBlue" },
+    { TableKind::AAT, DitherKind::Blue, 4, "AATBlue" },
+    { TableKind::AAT, DitherKind::Blue, 16, "AATBlue" },
+    { TableKind::AAT, DitherKind::Blue, 256, "AATBlue" },
+};
+
+// Blurs with a half float AAT, and writes out how its error against BoxBlur compares to 8 bit and 16 bit unorm AATs
+void TestAATHalf(const uint8* source, const std::vector<uint32>& SAT, int width, int height, const int* radiuses, size_t numRadiuses, const char* baseFileName)
+{
+    std::vector<uint16> AATHalf;
+    BuildAATHalf(SAT, width, height, AATHalf);
 
-			float A = float((startX >= 0 && startY >= 0) ? AAT[startY*width + startX] : 0) / float(256 * scale);
-            A *= float((startY + 1)*(startX + 1));
+    std::vector<uint32> AAT8Bit, AAT16Bit;
+    BuildTableVariant(SAT, width, height, { TableKind::AAT, DitherKind::Round, 1, "AAT" }, g_blueNoise, 0, AAT8Bit);
+    BuildTableVariant(SAT, width, height, { TableKind::AAT, DitherKind::Round, 256, "AAT" }, g_blueNoise, 0, AAT16Bit);
 
-            float B = float((startY >= 0) ? AAT[startY*width + endX] : 0) / float(256 * scale);
-            B *= float((startY + 1)*(endX + 1));
+    char fileName[256];
+    sprintf_s(fileName, baseFileName, "_AATHalf");
+    strcat_s(fileName, ".txt");
 
-            float C = float((startX >= 0) ? AAT[endY*width + startX] : 0) / float(256 * scale);
-            C *= float((endY + 1)*(startX + 1));
+    FILE* file = nullptr;
+    fopen_s(&file, fileName, "w+t");
+    fprintf(file, "Error vs BoxBlur: mean absolute / root mean square / max\n");
 
-            float D = float(AAT[endY*width + endX]) / float(256 * scale);
-            D *= float((endY + 1)*(endX + 1));
+    for (size_t index = 0; index < numRadiuses; ++index)
+    {
+        int radius = radiuses[index];
 
-			float integratedValue = A + D - B - C;
+        std::vector<uint8> groundTruth, result;
+        BoxBlurSlidingWindow(source, width, height, radius, groundTruth);
 
-			float size = float((endY - startY)*(endX - startX));
+        AATBoxBlurImage(AAT8Bit, width, height, radius, 1, result, DefaultBlurOptions(radius));
+        BlurError error8Bit = CompareToGroundTruth(groundTruth, result);
 
-			uint8 average = uint8(0.5f + 255.0f * integratedValue / size);
+        AATBoxBlurImage(AAT16Bit, width, height, radius, 256, result, DefaultBlurOptions(radius));
+        BlurError error16Bit = CompareToGroundTruth(groundTruth, result);
 
-			result[iy*width + ix] = average;
-		}
-	}
+        AATHalfBoxBlurImage(AATHalf, width, height, radius, result, DefaultBlurOptions(radius));
+        BlurError errorHalf = CompareToGroundTruth(groundTruth, result);
 
-	char append[64];
-    sprintf_s(append, "_%i_%s_%ix", radius, technique, scale);
+        fprintf(file, "Radius %i:\n", radius);
+        fprintf(file, "  AAT 8 bit unorm:   %f / %f / %i\n", error8Bit.meanAbsolute, error8Bit.rootMeanSquare, error8Bit.maximum);
+        fprintf(file, "  AAT 16 bit unorm:  %f / %f / %i\n", error16Bit.meanAbsolute, error16Bit.rootMeanSquare, error16Bit.maximum);
+        fprintf(file, "  AAT 16 bit float:  %f / %f / %i\n", errorHalf.meanAbsolute, errorHalf.rootMeanSquare, errorHalf.maximum);
+
+        char append[64];
+        sprintf_s(append, "_%i_AATHalf", radius);
+        WriteBlurPNG(std::move(result), width, height, baseFileName, append);
+    }
 
-	char fileName[256];
-	sprintf_s(fileName, baseFileName, append);
-    printf("%s\n", fileName);
-	stbi_write_png(fileName, width, height, 1, &result[0], width);
+    fclose(file);
 }
 
-void TestAATvsSAT(uint8* source, int width, int height, const char* baseFileName)
+// Writes out the bits per texel of hierarchical SATs of a few shapes, checks they reconstruct the SAT exactly, and
+// blurs with one of them.
+void TestHierarchicalSAT(const std::vector<uint32>& SAT, int width, int height, const int* radiuses, size_t numRadiuses, const char* baseFileName)
 {
-    std::random_device rd;
-    std::mt19937 rng(rd());
-    std::uniform_real_distribution<float> dist(0, 1.0f);
+    uint32 SATMax = 0;
+    for (uint32 v : SAT)
+        SATMax = std::max(SATMax, v);
+    int flatBits = int(std::ceil(std::log2(double(SATMax))));
 
-    // make Summed Area Tables
-    std::vector<uint32> SAT;
-	std::vector<int32> SATBiased127;
-    SAT.resize(width * height);
-	SATBiased127.resize(width * height);
-    for (size_t iy = 0; iy < height; ++iy)
+    char fileName[256];
+    sprintf_s(fileName, baseFileName, "_HSAT");
+    strcat_s(fileName, ".txt");
+
+    FILE* file = nullptr;
+    fopen_s(&file, fileName, "w+t");
+    fprintf(file, "Flat SAT: %i bits per texel\n", flatBits);
+
+    int blockSizes[] = { 2, 4, 8, 16 };
+    for (int numLevels = 2; numLevels <= 3; ++numLevels)
+    {
+        for (int blockSize : blockSizes)
+        {
+            HierarchicalSAT table;
+            BuildHierarchicalSAT(SAT, width, height, blockSize, numLevels, table);
+
+            size_t mismatches = 0;
+            for (int iy = 0; iy < height; ++iy)
+            {
+                for (int ix = 0; ix < width; ++ix)
+                {
+                    if (QueryHierarchicalSAT(table, ix, iy) != SAT[iy*width + ix])
+                        mismatches++;
+                }
+            }
+
+            fprintf(file, "%i levels, %ix%i blocks: %f bits per texel (", numLevels, blockSize, blockSize, HierarchicalSATBitsPerTexel(table));
+            for (size_t level = 0; level < table.levels.size(); ++level)
+                fprintf(file, "%s%i", level > 0 ? ", " : "", table.levels[level].numBits);
+            fprintf(file, " bits per level). %zu mismatched texels\n", mismatches);
+        }
+    }
+    fclose(file);
+
+    HierarchicalSAT table;
+    BuildHierarchicalSAT(SAT, width, height, 8, 2, table);
+    for (size_t index = 0; index < numRadiuses; ++index)
+        HierarchicalSATBoxBlur(table, width, height, radiuses[index], baseFileName, "HSAT");
+}
+
+// Blurs with scaled SATs and checks them against SATBoxBlurImage. A table with no bits dropped should match it exactly,
+// and one with bits dropped should be within 1, as BuildScaledSAT only accepts sizes whose error is under half a level.
+// 16 bits can't hold 3x3 up to 201x201 boxes that way, which BuildScaledSAT should refuse. Blurs with boxes outside of
+// a table's sizes should be refused too.
+void TestScaledSAT(const uint8* source, const std::vector<uint32>& SAT, int width, int height, const char* baseFileName)
+{
+    struct ScaledSATTest
+    {
+        int storageBits;
+        int minFilterSize;
+        int maxFilterSize;
+        bool buildable;
+    };
+    static const ScaledSATTest c_tests[] =
+    {
+        { 16, 3, 201, false },
+        { 16, 63, 201, true },
+        { 24, 3, 201, true },
+    };
+    static const int c_radiuses[] = { 1, 5, 25, 31, 100 };
+
+    char fileName[256];
+    sprintf_s(fileName, baseFileName, "_ScaledSAT");
+    strcat_s(fileName, ".txt");
+
+    FILE* file = nullptr;
+    fopen_s(&file, fileName, "w+t");
+    fprintf(file, "Pixels that differ from SATBoxBlurImage / most they differ by (allowed)\n");
+
+    for (const ScaledSATTest& test : c_tests)
+    {
+        ScaledSAT table;
+        bool built = BuildScaledSAT(source, width, height, test.minFilterSize, test.minFilterSize, test.maxFilterSize, test.maxFilterSize, test.storageBits, table);
+        fprintf(file, "%i bit storage, %ix%i to %ix%i boxes: %i low bits dropped, %s %s\n", test.storageBits, test.minFilterSize, test.minFilterSize,
+            test.maxFilterSize, test.maxFilterSize, table.droppedBits, built ? "built" : "refused", built == test.buildable ? "PASS" : "FAIL");
+        if (!built)
+            continue;
+
+        for (int radius : c_radiuses)
+        {
+            int diameter = radius * 2 + 1;
+            std::vector<uint8> expected, result;
+            bool blurred = ScaledSATBoxBlurImage(table, radius, result, DefaultBlurOptions(radius));
+            if (diameter < test.minFilterSize || diameter > test.maxFilterSize)
+            {
+                fprintf(file, "  Radius %i: outside of the sizes, %s %s\n", radius, blurred ? "blurred" : "refused", blurred ? "FAIL" : "PASS");
+                continue;
+            }
+
+            SATBoxBlurImage(SAT, width, height, radius, 1, 32, expected);
+
+            int mismatches = 0;
+            int maximum = 0;
+            for (size_t index = 0; index < result.size(); ++index)
+            {
+                int difference = std::abs(int(result[index]) - int(expected[index]));
+                mismatches += difference > 0 ? 1 : 0;
+                maximum = std::max(maximum, difference);
+            }
+
+            int allowed = table.droppedBits > 0 ? 1 : 0;
+            fprintf(file, "  Radius %i: %i / %i (%i) %s\n", radius, mismatches, maximum, allowed, maximum <= allowed ? "PASS" : "FAIL");
+
+            char append[64];
+            sprintf_s(append, "_%i_SATScaled%ibit", radius, test.storageBits);
+            WriteBlurPNG(std::move(result), width, height, baseFileName, append);
+        }
+    }
+
+    fclose(file);
+}
+
+// Depth of field like blurs, in focus across the middle row and blurring up to maxRadius at the top and bottom. The
+// float map is written as images. The uint8 maps should give each pixel the same result as a fixed radius blur. Besides
+// the smooth map, where each row is one long run of a radius, there is the smooth map with per pixel jitter and a map
+// of random radiuses, whose short runs go through the bucketed gathers. The SIMD and scalar paths should match too.
+// This toggles g_allowSIMD, so it has to run while no other blurs are.
+void TestVariableRadius(const std::vector<uint32>& SAT, int width, int height, int maxRadius, const char* baseFileName)
+{
+    std::mt19937 rng(0);
+    std::vector<float> radiusMapFloat(width * height);
+    std::vector<uint8> radiusMaps[3];
+    for (std::vector<uint8>& radiusMap : radiusMaps)
+        radiusMap.resize(width * height);
+    for (int iy = 0; iy < height; ++iy)
     {
-        for (size_t ix = 0; ix < width; ++ix)
+        float radius = float(maxRadius) * fabsf(float(iy) / float(height - 1) * 2.0f - 1.0f);
+        for (int ix = 0; ix < width; ++ix)
+        {
+            radiusMapFloat[iy*width + ix] = radius;
+            radiusMaps[0][iy*width + ix] = uint8(radius + 0.5f);
+            radiusMaps[1][iy*width + ix] = uint8(std::min(std::max(int(radius + 0.5f) + int(rng() % 5) - 2, 0), maxRadius));
+            radiusMaps[2][iy*width + ix] = uint8(rng() % (maxRadius + 1));
+        }
+    }
+    const char* mapNames[] = { "smooth", "jittered", "random" };
+
+    NoiseTexture noNoise;
+    std::vector<uint32> AAT;
+    BuildTableVariant(SAT, width, height, { TableKind::AAT, DitherKind::Round, 256, "AAT" }, noNoise, 0, AAT);
+
+    char fileName[256];
+    sprintf_s(fileName, baseFileName, "_VariableRadius");
+    strcat_s(fileName, ".txt");
+
+    FILE* file = nullptr;
+    fopen_s(&file, fileName, "w+t");
+    fprintf(file, "Pixels of the uint8 radius map blurs that differ from fixed radius blurs, and from the scalar blurs\n");
+
+    bool allowSIMD = g_allowSIMD;
+    for (bool isAAT : { false, true })
+    {
+        std::vector<uint8> result, scalarResult;
+        auto blurUInt8 = [&](const std::vector<uint8>& radiusMap, std::vector<uint8>& result)
+        {
+            if (isAAT)
+                AATBoxBlurImageVariableRadius(AAT, width, height, &radiusMap[0], 256, result);
+            else
+                SATBoxBlurImageVariableRadius(SAT, width, height, &radiusMap[0], result);
+        };
+        auto blurFloat = [&](std::vector<uint8>& result)
         {
-			// make SAT
-			{
-				uint32 i_xy = uint32(source[iy*width + ix]);
+            if (isAAT)
+                AATBoxBlurImageVariableRadius(AAT, width, height, &radiusMapFloat[0], 256, result);
+            else
+                SATBoxBlurImageVariableRadius(SAT, width, height, &radiusMapFloat[0], result);
+        };
+
+        // the fixed radius blurs, which every map's pixels are checked against
+        std::vector<std::vector<uint8>> fixedResults(maxRadius + 1);
+        for (int radius = 0; radius <= maxRadius; ++radius)
+        {
+            if (isAAT)
+                AATBoxBlurImage(AAT, width, height, radius, 256, fixedResults[radius]);
+            else
+                SATBoxBlurImage(SAT, width, height, radius, 1, 32, fixedResults[radius]);
+        }
 
-				uint32 I_xny = (ix > 0) ? SAT[iy*width + (ix - 1)] : 0;
-				uint32 I_xyn = (iy > 0) ? SAT[(iy - 1)*width + ix] : 0;
-				uint32 I_xnyn = (ix > 0 && iy > 0) ? SAT[(iy - 1)*width + (ix - 1)] : 0;
+        for (int mapIndex = 0; mapIndex < int(_countof(radiusMaps)); ++mapIndex)
+        {
+            const std::vector<uint8>& radiusMap = radiusMaps[mapIndex];
+            blurUInt8(radiusMap, result);
+            g_allowSIMD = false;
+            blurUInt8(radiusMap, scalarResult);
+            g_allowSIMD = allowSIMD;
+
+            int mismatches = 0;
+            int scalarMismatches = 0;
+            for (size_t index = 0; index < result.size(); ++index)
+            {
+                mismatches += (result[index] != fixedResults[radiusMap[index]][index]) ? 1 : 0;
+                scalarMismatches += (result[index] != scalarResult[index]) ? 1 : 0;
+            }
+            fprintf(file, "  %s %s map: %i / %i %s\n", isAAT ? "AAT" : "SAT", mapNames[mapIndex], mismatches, scalarMismatches,
+                (mismatches == 0 && scalarMismatches == 0) ? "PASS" : "FAIL");
+        }
 
-				SAT[iy*width + ix] = i_xy + I_xny + I_xyn - I_xnyn;
-			}
+        blurFloat(result);
+        g_allowSIMD = false;
+        blurFloat(scalarResult);
+        g_allowSIMD = allowSIMD;
+        fprintf(file, "  %s float map vs scalar: %s\n", isAAT ? "AAT" : "SAT", result == scalarResult ? "PASS" : "FAIL");
+        WriteBlurPNG(std::move(result), width, height, baseFileName, isAAT ? "_VariableRadius_AAT" : "_VariableRadius_SAT");
+    }
+
+    fclose(file);
+}
 
-			// make biased SAT
-			{
-				int32 i_xy = int32(source[iy*width + ix]) - 127;
+// Motion blurs. The trailing horizontal box and the vertical one are the 1 pixel tall and wide line cases. The others
+// are offset past their radius, so they don't cover the pixel, and the last is off the image for every pixel, which
+// clamps it to the right edge.
+void TestMotionBlur(const uint8* source, const std::vector<uint32>& SAT, const std::vector<int32>& SATBiased127, int width, int height, int length, const char* baseFileName)
+{
+    NoiseTexture noNoise;
+    std::vector<uint32> AAT;
+    BuildTableVariant(SAT, width, height, { TableKind::AAT, DitherKind::Round, 256, "AAT" }, noNoise, 0, AAT);
+
+    BlurBox boxes[] = {
+        { length, 0, -length, 0 },
+        { 0, length, 0, 0 },
+        { length / 2, 0, -length, 0 },
+        { length / 4, length / 4, length, -length },
+        { 2, 2, width + length, 0 },
+    };
+    const char* boxNames[] = { "Horizontal", "Vertical", "Trailing", "Diagonal", "OffImage" };
+
+    BlurOptions clampOptions;
+    clampOptions.clampEveryPixel = true;
+
+    char fileName[256];
+    sprintf_s(fileName, baseFileName, "_MotionBlur");
+    strcat_s(fileName, ".txt");
+
+    FILE* file = nullptr;
+    fopen_s(&file, fileName, "w+t");
+    fprintf(file, "Pixels of the SAT motion blurs that differ from averaging the box directly, and of the AAT and biased SAT\n");
+    fprintf(file, "motion blurs that differ from clamping every pixel\n");
+
+    for (int boxIndex = 0; boxIndex < int(_countof(boxes)); ++boxIndex)
+    {
+        const BlurBox& box = boxes[boxIndex];
 
-				int32 I_xny = (ix > 0) ? SATBiased127[iy*width + (ix - 1)] : - 127;
-				int32 I_xyn = (iy > 0) ? SATBiased127[(iy - 1)*width + ix] : - 127;
-				int32 I_xnyn = (ix > 0 && iy > 0) ? SATBiased127[(iy - 1)*width + (ix - 1)] : - 127;
+        std::vector<uint8> result;
+        std::vector<uint8> clampResult;
+        SATBoxBlurImage(SAT, width, height, box, 1, 32, result);
 
-				SATBiased127[iy*width + ix] = i_xy + I_xny + I_xyn - I_xnyn;
-			}
+        int mismatches = 0;
+        for (int iy = 0; iy < height; ++iy)
+        {
+            for (int ix = 0; ix < width; ++ix)
+            {
+                int startX = std::min(std::max(ix + box.offsetX - box.radiusX, 0), width - 1);
+                int endX = std::min(std::max(ix + box.offsetX + box.radiusX, 0), width - 1);
+                int startY = std::min(std::max(iy + box.offsetY - box.radiusY, 0), height - 1);
+                int endY = std::min(std::max(iy + box.offsetY + box.radiusY, 0), height - 1);
+
+                int sum = 0;
+                for (int y = startY; y <= endY; ++y)
+                    for (int x = startX; x <= endX; ++x)
+                        sum += source[y*width + x];
+
+                int area = (endX - startX + 1) * (endY - startY + 1);
+                mismatches += (result[iy*width + ix] != uint8((sum * 2 + area) / (area * 2))) ? 1 : 0;
+            }
         }
+        fprintf(file, "  %s SAT: %i %s\n", boxNames[boxIndex], mismatches, mismatches == 0 ? "PASS" : "FAIL");
+
+        char suffix[64];
+        sprintf_s(suffix, "_MotionBlur%s_SAT", boxNames[boxIndex]);
+        WriteBlurPNG(std::move(result), width, height, baseFileName, suffix);
+
+        SATBoxBlurBiasedImage(SATBiased127, width, height, box, 127, result);
+        SATBoxBlurBiasedImage(SATBiased127, width, height, box, 127, clampResult, clampOptions);
+        fprintf(file, "  %s SATBiased127 vs clamped: %s\n", boxNames[boxIndex], result == clampResult ? "PASS" : "FAIL");
+
+        AATBoxBlurImage(AAT, width, height, box, 256, result);
+        AATBoxBlurImage(AAT, width, height, box, 256, clampResult, clampOptions);
+        fprintf(file, "  %s AAT vs clamped: %s\n", boxNames[boxIndex], result == clampResult ? "PASS" : "FAIL");
+        sprintf_s(suffix, "_MotionBlur%s_AAT", boxNames[boxIndex]);
+        WriteBlurPNG(std::move(result), width, height, baseFileName, suffix);
     }
 
+    fclose(file);
+}
+
+void TestAATvsSAT(uint8* source, int width, int height, const char* baseFileName)
+{
+    std::random_device rd;
+    uint32 whiteNoiseSeed = rd();
+
+    // make Summed Area Tables
+    std::vector<uint32> SAT;
+	std::vector<int32> SATBiased127;
+    BuildSATsParallel(source, width, height, SAT, SATBiased127);
+
 	// get and write out max / min value in biased SAT
 	{
 		int32 SATBiased127Min = SATBiased127[0];
@@ -296,147 +684,156 @@ void TestAATvsSAT(uint8* source, int width, int height, const char* baseFileName
 		
 		FILE* file = nullptr;
 		fopen_s(&file, fileName, "w+t");
-		fprintf(file, "SAT Max: %u (%i bits)\n", SATMax, int(std::ceilf(std::log2f(float(SATMax)))));
-		fprintf(file, "Biased 127 Min = %i (%i bits)\n", SATBiased127Min, int(std::ceilf(1.0f + std::log2f(std::fabsf(float(SATBiased127Min))))));
-		fprintf(file, "Biased 127 Max = %i (%i bits)\n", SATBiased127Max, int(std::ceilf(1.0f + std::log2f(std::fabsf(float(SATBiased127Max))))));
+		fprintf(file, "SAT Max: %u (%i bits)\n", SATMax, int(ceilf(log2f(float(SATMax)))));
+		fprintf(file, "Biased 127 Min = %i (%i bits)\n", SATBiased127Min, int(ceilf(1.0f + log2f(fabsf(float(SATBiased127Min))))));
+		fprintf(file, "Biased 127 Max = %i (%i bits)\n", SATBiased127Max, int(ceilf(1.0f + log2f(fabsf(float(SATBiased127Max))))));
 		fclose(file);
 	}
 
-    // make Averaged Area Tables (AATs) and other Summed Area Table variants
-    std::vector<uint32> AAT, AAT4x, AAT16x, AAT256x;
-	std::vector<uint32> AATBlue, AATBlue4x, AATBlue16x, AATBlue256x;
-	std::vector<uint32> AATWhite, AATWhite4x, AATWhite16x, AATWhite256x;
-    std::vector<uint32> SAT4x, SAT16x, SAT256x;
-    std::vector<uint32> SATBlue4x, SATBlue16x, SATBlue256x;
-    std::vector<uint32> SATWhite4x, SATWhite16x, SATWhite256x;
-	AAT.resize(width*height);
-	AATWhite.resize(width*height);
-	AATBlue.resize(width*height);
-	AAT4x.resize(width*height);
-	AAT16x.resize(width*height);
-	AAT256x.resize(width*height);
-	AATWhite4x.resize(width*height);
-	AATWhite16x.resize(width*height);
-    AATWhite256x.resize(width*height);
-	AATBlue4x.resize(width*height);
-	AATBlue16x.resize(width*height);
-    AATBlue256x.resize(width*height);
-    SAT4x.resize(width * height);
-    SAT16x.resize(width * height);
-    SAT256x.resize(width * height);
-    SATWhite4x.resize(width * height);
-    SATWhite16x.resize(width * height);
-    SATWhite256x.resize(width * height);
-    SATBlue4x.resize(width * height);
-    SATBlue16x.resize(width * height);
-    SATBlue256x.resize(width * height);
-    for (size_t iy = 0; iy < height; ++iy)
-    {
-        for (size_t ix = 0; ix < width; ++ix)
-        {
-			// tile the blue noise texture across the image to get blue noise random numbers per pixel. blue noise tiles well.
-			float blueNoise = float(g_blueNoisePixels[((iy%g_blueNoiseHeight) * g_blueNoiseWidth + (ix%g_blueNoiseWidth))*g_blueNoiseChannels])/255.0f;
-            float whiteNoise = dist(rng);
-
-            double value = double(SAT[iy*width + ix]);
-			double rangeSize = double((ix + 1)*(iy + 1));
-
-            // ------------------ AAT's ------------------
-
-            // rounding
-			AAT[iy*width + ix] = uint32(0.5f + (value / rangeSize)); 
-			AAT4x[iy*width + ix] = uint32(0.5f + 4.0f * (value / rangeSize));  // an extra 2 bits of precision (10 bit unorm)
-			AAT16x[iy*width + ix] = uint32(0.5f + 16.0f * (value / rangeSize)); // an extra 4 bits of precision (12 bit unorm)
-			AAT256x[iy*width + ix] = uint32(0.5f + 256.0f * (value / rangeSize)); // an extra 8 bits of precision (16 bit unorm)
-
-            // white noise dithering
-            AATWhite[iy*width + ix] = uint32(whiteNoise + (value / rangeSize));
-			AATWhite4x[iy*width + ix] = uint32(whiteNoise + 4.0f * (value / rangeSize)); // an extra 2 bits of precision and white noise dithering
-			AATWhite16x[iy*width + ix] = uint32(whiteNoise + 16.0f * (value / rangeSize)); // an extra 4 bits of precision and white noise dithering
-            AATWhite256x[iy*width + ix] = uint32(whiteNoise + 256.0f * (value / rangeSize)); // an extra 8 bits of precision and white noise dithering
-
-            // blue noise dithering
-            AATBlue[iy*width + ix] = uint32(blueNoise + (value / rangeSize));
-			AATBlue4x[iy*width + ix] = uint32(blueNoise + 4.0f * (value / rangeSize)); // an extra 2 bits of precision and blue noise dithering
-			AATBlue16x[iy*width + ix] = uint32(blueNoise + 16.0f * (value / rangeSize)); // an extra 4 bits of precision and blue noise dithering
-            AATBlue256x[iy*width + ix] = uint32(blueNoise + 256.0f * (value / rangeSize)); // an extra 8 bits of precision and blue noise dithering
-
-            // ------------------ SAT's ------------------
-
-            // NOTE: doubles can exactly represent all uint32 integers
-
-            // rounding 
-            SAT4x[iy*width + ix] = uint32(0.5 + double(SAT[iy*width + ix]) / 4.0);
-            SAT16x[iy*width + ix] = uint32(0.5 + double(SAT[iy*width + ix]) / 16.0);
-            SAT256x[iy*width + ix] = uint32(0.5 + double(SAT[iy*width + ix]) / 256.0);
-
-            // white noise dithering 
-            SATWhite4x[iy*width + ix] = uint32(double(whiteNoise) + double(SAT[iy*width + ix]) / 4.0);
-            SATWhite16x[iy*width + ix] = uint32(double(whiteNoise) + double(SAT[iy*width + ix]) / 16.0);
-            SATWhite256x[iy*width + ix] = uint32(double(whiteNoise) + double(SAT[iy*width + ix]) / 256.0);
-
-            // blue noise dithering 
-            SATBlue4x[iy*width + ix] = uint32(double(blueNoise) + double(SAT[iy*width + ix]) / 4.0);
-            SATBlue16x[iy*width + ix] = uint32(double(blueNoise) + double(SAT[iy*width + ix]) / 16.0);
-            SATBlue256x[iy*width + ix] = uint32(double(blueNoise) + double(SAT[iy*width + ix]) / 256.0);
-        }
-    }
-
 	int radiuses[] = { 0, 1, 5, 25, 100 };
 
+    // Every (technique x scale) blur is independent, so they are all jobs on the thread pool. Each table blurs at every
+    // radius with one multi radius call. Output file names only depend on the job, so the results are the same regardless of
+    // thread count or order.
+    ThreadPool& pool = GetThreadPool();
+    ThreadPool::JobGroup jobs;
+
+	// regular box blur of source image
 	for (size_t index = 0; index < _countof(radiuses); ++index)
 	{
-		// regular box blur of source image
-		BoxBlur(source, width, height, radiuses[index], baseFileName);
-
-		// box blur with biased SAT
-		SATBoxBlurBiased(SATBiased127, width, height, radiuses[index], baseFileName, "SATBiased127", 127);
-
-		// box blur with rounded SAT
-		SATBoxBlur(SAT, width, height, radiuses[index], baseFileName, "SAT", 1, 32);
-        SATBoxBlur(SAT4x, width, height, radiuses[index], baseFileName, "SAT", 4, 32);
-        SATBoxBlur(SAT16x, width, height, radiuses[index], baseFileName, "SAT", 16, 32);
-        SATBoxBlur(SAT256x, width, height, radiuses[index], baseFileName, "SAT", 256, 32);
-
-        // box blur with white noise stochastically rounded SAT
-        SATBoxBlur(SATWhite4x, width, height, radiuses[index], baseFileName, "SATWhite", 4, 32);
-        SATBoxBlur(SATWhite16x, width, height, radiuses[index], baseFileName, "SATWhite", 16, 32);
-        SATBoxBlur(SATWhite256x, width, height, radiuses[index], baseFileName, "SATWhite", 256, 32);
-
-        // box blur with blue noise stochastically rounded SAT
-        SATBoxBlur(SATBlue4x, width, height, radiuses[index], baseFileName, "SATBlue", 4, 32);
-        SATBoxBlur(SATBlue16x, width, height, radiuses[index], baseFileName, "SATBlue", 16, 32);
-        SATBoxBlur(SATBlue256x, width, height, radiuses[index], baseFileName, "SATBlue", 256, 32);
-
-		// box blur with rounded AAT
-        AATBoxBlur(AAT, width, height, radiuses[index], baseFileName, "AAT", 1);
-		AATBoxBlur(AAT4x, width, height, radiuses[index], baseFileName, "AAT", 4);
-		AATBoxBlur(AAT16x, width, height, radiuses[index], baseFileName, "AAT", 16);
-		AATBoxBlur(AAT256x, width, height, radiuses[index], baseFileName, "AAT", 256);
-
-		// box blur with white noise stochastically rounded AAT
-        AATBoxBlur(AATWhite, width, height, radiuses[index], baseFileName, "AATWhite", 1);
-		AATBoxBlur(AATWhite4x, width, height, radiuses[index], baseFileName, "AATWhite", 4);
-		AATBoxBlur(AATWhite16x, width, height, radiuses[index], baseFileName, "AATWhite", 16);
-        AATBoxBlur(AATWhite256x, width, height, radiuses[index], baseFileName, "AATWhite", 256);
-
-        // box blur with blue noise stochastically rounded AAT
-        AATBoxBlur(AATBlue, width, height, radiuses[index], baseFileName, "AATBlue", 1);
-		AATBoxBlur(AATBlue4x, width, height, radiuses[index], baseFileName, "AATBlue", 4);
-		AATBoxBlur(AATBlue16x, width, height, radiuses[index], baseFileName, "AATBlue", 16);
-        AATBoxBlur(AATBlue256x, width, height, radiuses[index], baseFileName, "AATBlue", 256);
+        int radius = radiuses[index];
+        pool.AddJob(jobs, [=]() { BoxBlur(source, width, height, radius, baseFileName); });
 	}
 
+	// box blur with biased SAT
+    pool.AddJob(jobs, [=, &SATBiased127, &radiuses]() { SATBoxBlurBiasedMultiRadius(SATBiased127, width, height, radiuses, _countof(radiuses), baseFileName, "SATBiased127", 127); });
+
+	// box blur with full precision SAT
+    pool.AddJob(jobs, [=, &SAT, &radiuses]() { SATBoxBlurMultiRadius(SAT, width, height, radiuses, _countof(radiuses), baseFileName, "SAT", 1, 32); });
+
+    // Make the Averaged Area Tables (AATs) and other Summed Area Table variants on demand. There are g_maxLiveTables
+    // jobs, each with one table buffer, that take the next variant until there are none left, so at most that many
+    // tables are alive at once however many workers there are. Nothing blocks waiting for a buffer, so a job that is
+    // run by a thread waiting inside another job can't deadlock.
+    std::atomic<int> nextVariant{ 0 };
+    for (int lane = 0; lane < std::max(g_maxLiveTables, 1); ++lane)
+    {
+        pool.AddJob(jobs, [=, &SAT, &radiuses, &nextVariant]()
+        {
+            std::vector<uint32> table;
+            for (int index = nextVariant++; index < int(_countof(c_tableVariants)); index = nextVariant++)
+            {
+                const TableVariant& variant = c_tableVariants[index];
+                BuildTableVariant(SAT, width, height, variant, g_blueNoise, whiteNoiseSeed, table);
+
+                if (variant.kind == TableKind::SAT)
+                    SATBoxBlurMultiRadius(table, width, height, radiuses, _countof(radiuses), baseFileName, variant.technique, variant.scale, 32);
+                else
+                    AATBoxBlurMultiRadius(table, width, height, radiuses, _countof(radiuses), baseFileName, variant.technique, variant.scale);
+            }
+        });
+    }
+
+    // hierarchical SAT
+    pool.AddJob(jobs, [=, &SAT, &radiuses]() { TestHierarchicalSAT(SAT, width, height, radiuses, _countof(radiuses), baseFileName); });
+
+    // half float AAT
+    pool.AddJob(jobs, [=, &SAT, &radiuses]() { TestAATHalf(source, SAT, width, height, radiuses, _countof(radiuses), baseFileName); });
+
 	// do a 7x7 and a 9x9 box blur with the 14 bit SAT. 7x7 should be fine. 9x9 should not be.
-	SATBoxBlur(SAT, width, height, 1, baseFileName, "SAT14bit", 1, 14);
-	SATBoxBlur(SAT, width, height, 2, baseFileName, "SAT14bit", 1, 14);
-	SATBoxBlur(SAT, width, height, 3, baseFileName, "SAT14bit", 1, 14);
-	SATBoxBlur(SAT, width, height, 4, baseFileName, "SAT14bit", 1, 14);
+    for (int radius = 1; radius <= 4; ++radius)
+        pool.AddJob(jobs, [=, &SAT]() { SATBoxBlur(SAT, width, height, radius, baseFileName, "SAT14bit", 1, 14); });
+
+    // The same 9x9 limit with a wrap around SAT, which picks its bit count from the filter size: 15 bits, stored as 16 bit
+    pool.AddJob(jobs, [=, &pool, &jobs]()
+    {
+        std::shared_ptr<WrapAroundSAT> table = std::make_shared<WrapAroundSAT>();
+        BuildWrapAroundSAT(source, width, height, 9, 9, *table);
+        for (int radius = 1; radius <= 4; ++radius)
+            pool.AddJob(jobs, [=]() { WrapAroundSATBoxBlur(*table, radius, baseFileName, "SATWrap9x9"); });
+    });
+
+    // scaled SATs, over the radiuses their boxes cover
+    pool.AddJob(jobs, [=, &SAT]() { TestScaledSAT(source, SAT, width, height, baseFileName); });
+
+    // motion blurs, with line boxes and boxes offset off the pixel
+    pool.AddJob(jobs, [=, &SAT, &SATBiased127]() { TestMotionBlur(source, SAT, SATBiased127, width, height, 16, baseFileName); });
+
+    pool.Wait(jobs);
+
+    // variable radius blurs from depth of field like radius maps. This compares SIMD against scalar by toggling
+    // g_allowSIMD, so it runs after the other blurs are done.
+    TestVariableRadius(SAT, width, height, 16, baseFileName);
+}
+
+// Makes a SAT of a raw 8 bit greyscale image that may be too big to load, writing raw uint32 SAT rows to outFileName.
+// Only a row of each is in memory at a time.
+bool StreamSATFile(const char* inFileName, int width, int height, const char* outFileName)
+{
+    FILE* inFile = nullptr;
+    fopen_s(&inFile, inFileName, "rb");
+    if (!inFile)
+    {
+        printf("Could not open %s\n", inFileName);
+        return false;
+    }
+
+    FILE* outFile = nullptr;
+    fopen_s(&outFile, outFileName, "wb");
+    if (!outFile)
+    {
+        printf("Could not open %s\n", outFileName);
+        fclose(inFile);
+        return false;
+    }
+
+    bool ret = BuildSATStreaming(width, height,
+        [&](uint8* row)
+        {
+            return fread(row, 1, width, inFile) == size_t(width);
+        },
+        [&](const uint32* row)
+        {
+            return fwrite(row, sizeof(uint32), width, outFile) == size_t(width);
+        }
+    );
+
+    if (!ret)
+        printf("Failed making %s from %s. Is the input %i x %i?\n", outFileName, inFileName, width, height);
+
+    fclose(inFile);
+    fclose(outFile);
+    return ret;
 }
 
 int main(int argc, char** argv)
 {
-	g_blueNoisePixels = stbi_load("bluenoise.png", &g_blueNoiseWidth, &g_blueNoiseHeight, &g_blueNoiseChannels, 4);
+    for (int index = 1; index < argc; ++index)
+    {
+        // -streamsat in.raw width height out.sat makes a SAT file from a raw image, and does nothing else
+        if (!strcmp(argv[index], "-streamsat") && index + 4 < argc)
+            return StreamSATFile(argv[index + 1], atoi(argv[index + 2]), atoi(argv[index + 3]), argv[index + 4]) ? 0 : 1;
+
+        if (!strcmp(argv[index], "-boxblurreference"))
+            g_boxBlurMode = BoxBlurMode::Reference;
+        else if (!strcmp(argv[index], "-boxblurvalidate"))
+            g_boxBlurMode = BoxBlurMode::Validate;
+        else if (!strcmp(argv[index], "-nosimd"))
+            g_allowSIMD = false;
+        else if (!strcmp(argv[index], "-tiled"))
+            g_tiledBlurs = true;
+        else if (!strncmp(argv[index], "-threads=", 9))
+            g_numThreads = atoi(&argv[index][9]);
+        else if (!strncmp(argv[index], "-pngthreads=", 12))
+            g_numPNGThreads = atoi(&argv[index][12]);
+        else if (!strncmp(argv[index], "-maxtables=", 11))
+            g_maxLiveTables = atoi(&argv[index][11]);
+    }
+
+    int blueNoiseComponents;
+	stbi_uc* blueNoisePixels = stbi_load("bluenoise.png", &g_blueNoise.width, &g_blueNoise.height, &blueNoiseComponents, 4);
+    g_blueNoise.pixels = blueNoisePixels;
+    g_blueNoise.channels = 4;
 
 	// image test
 	{
@@ -463,7 +860,10 @@ int main(int argc, char** argv)
 	}
 	*/
 
-	stbi_image_free(g_blueNoisePixels);
+	stbi_image_free(blueNoisePixels);
+
+    // make sure every queued PNG is on disk before exiting
+    GetPNGWriter().Flush();
     
     return 0;
 }
@@ -0,0 +1,249 @@
+#include "AAT.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+// Times table construction and every blur across a sweep of image sizes and radiuses.
+// Each benchmark is run repeatedly until it has taken at least g_minSeconds, and the mean is reported, like google benchmark does.
+//
+// GB/s is the minimum memory traffic of the operation divided by the time taken: bytes read plus bytes written per pixel,
+// counting each table entry and source / result pixel once. Caches make the real traffic differ from this, but it shows
+// how close to memory bandwidth an operation is.
+// * Table builds read the uint8 source and write the table.
+// * Blurs read the table and write the uint8 result. Blurs read four table entries per pixel, but neighbouring pixels share them.
+
+static double g_minSeconds = 0.5;
+static int g_minSize = 256;
+static int g_maxSize = 16384;
+static const char* g_filter = nullptr;
+
+// Calls callback until at least g_minSeconds has passed, and prints mean ns per pixel and GB/s
+template <typename LAMBDA>
+void RunBenchmark(const char* name, int size, int radius, size_t bytesPerPixel, const LAMBDA& callback)
+{
+    char fullName[256];
+    if (radius > 0)
+        sprintf_s(fullName, "%s/%ix%i/r%i", name, size, size, radius);
+    else
+        sprintf_s(fullName, "%s/%ix%i", name, size, size);
+
+    if (g_filter && !strstr(fullName, g_filter))
+        return;
+
+    // warm up, which also sizes any output vectors
+    callback();
+
+    int iterations = 0;
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed;
+    do
+    {
+        callback();
+        ++iterations;
+        elapsed = std::chrono::high_resolution_clock::now() - start;
+    }
+    while (elapsed.count() < g_minSeconds);
+
+    double pixels = double(size) * double(size);
+    double seconds = elapsed.count() / double(iterations);
+    double nsPerPixel = seconds * 1e9 / pixels;
+    double GBPerSecond = pixels * double(bytesPerPixel) / seconds / 1e9;
+
+    printf("%-40s %8.3f ns/pixel %8.2f GB/s %8i iterations\n", fullName, nsPerPixel, GBPerSecond, iterations);
+    fflush(stdout);
+}
+
+// Repeats the source image to make a size x size image
+void TileImage(const uint8* source, int sourceWidth, int sourceHeight, int size, std::vector<uint8>& result)
+{
+    result.resize(size_t(size) * size_t(size));
+    for (int iy = 0; iy < size; ++iy)
+    {
+        const uint8* sourceRow = &source[(iy % sourceHeight) * sourceWidth];
+        uint8* resultRow = &result[size_t(iy) * size_t(size)];
+        for (int ix = 0; ix < size; ++ix)
+            resultRow[ix] = sourceRow[ix % sourceWidth];
+    }
+}
+
+// Whether the image's tables hold its sums without wrapping. The uint32 SAT's largest entry is the sum of every pixel.
+// Each biased SAT entry is a sum of (pixel - bias) over a rectangle, less bias for the border, so its size is at most
+// the sum of |pixel - bias| plus bias. The biased SAT is int32, where overflow is undefined behavior.
+// At 16K x 16K both can overflow, and start to near 8K x 8K for very dark or bright images.
+void TableSumsFit(const std::vector<uint8>& source, int32 bias, bool& SATFits, bool& biasedSATFits)
+{
+    uint64_t sum = 0;
+    uint64_t biasedSum = 0;
+    for (uint8 value : source)
+    {
+        sum += value;
+        biasedSum += uint64_t(std::abs(int32(value) - bias));
+    }
+    SATFits = sum <= uint64_t(uint32(-1));
+    biasedSATFits = biasedSum + uint64_t(bias) <= uint64_t(0x7fffffff);
+}
+
+// Tables are built and freed as they are needed, so that the 16K x 16K sizes fit in a few GB of memory.
+// Each table is built once outside of the timing too, so the blurs have a table when -filter skips the build benchmarks.
+void BenchmarkSize(const uint8* image, int imageWidth, int imageHeight, int size)
+{
+    static const int c_radiuses[] = { 1, 5, 25, 100 };
+    static const int c_AATScales[] = { 1, 4, 16, 256 };
+
+    std::vector<uint8> source;
+    TileImage(image, imageWidth, imageHeight, size, source);
+
+    std::vector<uint8> result;
+
+    // Tables whose sums don't fit are skipped. A wrapped uint32 SAT still blurs correctly with the wrapping math, but
+    // AATs made from it are meaningless, so those are skipped too.
+    bool SATFits, biasedSATFits;
+    TableSumsFit(source, 127, SATFits, biasedSATFits);
+    if (!biasedSATFits)
+        printf("%ix%i: skipping biased SAT benchmarks, the int32 sums overflow\n", size, size);
+    if (!SATFits)
+        printf("%ix%i: skipping AAT benchmarks, the uint32 SAT wraps\n", size, size);
+
+    // The sliding window blur works from the source image directly
+    for (int radius : c_radiuses)
+        RunBenchmark("BoxBlurSlidingWindow", size, radius, 2, [&]() { BoxBlurSlidingWindow(&source[0], size, size, radius, result); });
+
+    // biased SAT
+    if (biasedSATFits)
+    {
+        std::vector<int32> SATBiased127;
+        BuildSATBiasedParallel(&source[0], size, size, 127, SATBiased127);
+        RunBenchmark("BuildSATBiasedParallel", size, 0, 1 + sizeof(int32), [&]() { BuildSATBiasedParallel(&source[0], size, size, 127, SATBiased127); });
+        for (int radius : c_radiuses)
+            RunBenchmark("SATBoxBlurBiasedImage", size, radius, sizeof(int32) + 1, [&]() { SATBoxBlurBiasedImage(SATBiased127, size, size, radius, 127, result); });
+    }
+
+    // SAT, which the AATs are then made from
+    std::vector<uint32> SAT;
+    BuildSATParallel(&source[0], size, size, SAT);
+    if (biasedSATFits)
+    {
+        std::vector<int32> SATBiased127;
+        RunBenchmark("BuildSATs", size, 0, 1 + sizeof(uint32) + sizeof(int32), [&]() { BuildSATs(&source[0], size, size, SAT, SATBiased127); });
+        RunBenchmark("BuildSATsParallel", size, 0, 1 + sizeof(uint32) + sizeof(int32), [&]() { BuildSATsParallel(&source[0], size, size, SAT, SATBiased127); });
+    }
+    RunBenchmark("BuildSATParallel", size, 0, 1 + sizeof(uint32), [&]() { BuildSATParallel(&source[0], size, size, SAT); });
+    for (int radius : c_radiuses)
+        RunBenchmark("SATBoxBlurImage", size, radius, sizeof(uint32) + 1, [&]() { SATBoxBlurImage(SAT, size, size, radius, 1, 32, result); });
+
+    // Wrap around SATs sized for each radius. These are 16 bit up to a 15x15 filter.
+    for (int radius : c_radiuses)
+    {
+        int diameter = radius * 2 + 1;
+        WrapAroundSAT table;
+        BuildWrapAroundSAT(&source[0], size, size, diameter, diameter, table);
+        size_t bytesPerEntry = table.numBits <= 16 ? sizeof(uint16) : sizeof(uint32);
+
+        char name[64];
+        sprintf_s(name, "BuildWrapAroundSAT%ix%i", diameter, diameter);
+        RunBenchmark(name, size, 0, 1 + bytesPerEntry, [&]() { BuildWrapAroundSAT(&source[0], size, size, diameter, diameter, table); });
+        RunBenchmark("WrapAroundSATBoxBlurImage", size, radius, bytesPerEntry + 1, [&]() { WrapAroundSATBoxBlurImage(table, radius, result); });
+    }
+
+    // Scaled SATs, which drop low bits to fit 16 bit storage and pack into 24 bits. 16 bits only keeps the error of
+    // boxes up to 201x201 under half a level from 63x63 up, so it only does the radiuses in that range.
+    for (int storageBits : { 16, 24 })
+    {
+        int minFilterSize = storageBits == 16 ? 63 : 3;
+        ScaledSAT table;
+        BuildScaledSAT(&source[0], size, size, minFilterSize, minFilterSize, 201, 201, storageBits, table);
+        size_t bytesPerEntry = size_t(storageBits / 8);
+
+        char name[64];
+        sprintf_s(name, "BuildScaledSAT%ibit", storageBits);
+        RunBenchmark(name, size, 0, 1 + bytesPerEntry, [&]() { BuildScaledSAT(&source[0], size, size, minFilterSize, minFilterSize, 201, 201, storageBits, table); });
+
+        sprintf_s(name, "ScaledSATBoxBlurImage%ibit", storageBits);
+        for (int radius : c_radiuses)
+        {
+            if (radius * 2 + 1 >= minFilterSize)
+                RunBenchmark(name, size, radius, bytesPerEntry + 1, [&]() { ScaledSATBoxBlurImage(table, radius, result); });
+        }
+    }
+
+    // AATs at each scale. Building one reads the SAT rather than the source.
+    if (SATFits)
+    {
+        NoiseTexture noNoise;
+        std::vector<uint32> AAT;
+        for (int scale : c_AATScales)
+        {
+            TableVariant variant = { TableKind::AAT, DitherKind::Round, scale, "AAT" };
+
+            char name[64];
+            BuildTableVariant(SAT, size, size, variant, noNoise, 0, AAT);
+            sprintf_s(name, "BuildAAT%ix", scale);
+            RunBenchmark(name, size, 0, sizeof(uint32) * 2, [&]() { BuildTableVariant(SAT, size, size, variant, noNoise, 0, AAT); });
+
+            sprintf_s(name, "AATBoxBlurImage%ix", scale);
+            for (int radius : c_radiuses)
+                RunBenchmark(name, size, radius, sizeof(uint32) + 1, [&]() { AATBoxBlurImage(AAT, size, size, radius, scale, result); });
+
+            sprintf_s(name, "AATBoxBlurImageInteger%ix", scale);
+            for (int radius : c_radiuses)
+                RunBenchmark(name, size, radius, sizeof(uint32) + 1, [&]() { AATBoxBlurImageInteger(AAT, size, size, radius, scale, result); });
+        }
+    }
+
+    // half float AAT
+    if (SATFits)
+    {
+        std::vector<uint16> AATHalf;
+        BuildAATHalf(SAT, size, size, AATHalf);
+        RunBenchmark("BuildAATHalf", size, 0, sizeof(uint32) + sizeof(uint16), [&]() { BuildAATHalf(SAT, size, size, AATHalf); });
+        for (int radius : c_radiuses)
+            RunBenchmark("AATHalfBoxBlurImage", size, radius, sizeof(uint16) + 1, [&]() { AATHalfBoxBlurImage(AATHalf, size, size, radius, result); });
+    }
+}
+
+int main(int argc, char** argv)
+{
+    for (int index = 1; index < argc; ++index)
+    {
+        if (!strcmp(argv[index], "-nosimd"))
+            g_allowSIMD = false;
+        else if (!strncmp(argv[index], "-threads=", 9))
+            g_numThreads = atoi(&argv[index][9]);
+        else if (!strncmp(argv[index], "-mintime=", 9))
+            g_minSeconds = atof(&argv[index][9]);
+        else if (!strncmp(argv[index], "-minsize=", 9))
+            g_minSize = atoi(&argv[index][9]);
+        else if (!strncmp(argv[index], "-maxsize=", 9))
+            g_maxSize = atoi(&argv[index][9]);
+        else if (!strncmp(argv[index], "-filter=", 8))
+            g_filter = &argv[index][8];
+        else
+        {
+            printf("Unknown option %s\n", argv[index]);
+            printf("Options: -nosimd -threads=N -mintime=seconds -minsize=N -maxsize=N -filter=substring\n");
+            return 1;
+        }
+    }
+
+    int width, height, components;
+    stbi_uc* pixels = stbi_load("scenery.png", &width, &height, &components, 1);
+    if (!pixels)
+    {
+        printf("Could not load scenery.png. Run from the directory it is in.\n");
+        return 1;
+    }
+
+    // 256^2 up to 16K^2, multiplying the size by 4 each time
+    for (int size = 256; size <= g_maxSize; size *= 4)
+    {
+        if (size >= g_minSize)
+            BenchmarkSize(pixels, width, height, size);
+    }
+
+    stbi_image_free(pixels);
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include "TableFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+size_t TableValueSize(TableValueFormat format)
+{
+    return format == TableValueFormat::Half ? sizeof(uint16) : sizeof(uint32);
+}
+
+static uint64_t TableDataSize(const TableFileHeader& header)
+{
+    return uint64_t(header.width) * uint64_t(header.height) * uint64_t(header.channels) * uint64_t(TableValueSize(header.format));
+}
+
+bool WriteTableFile(const char* fileName, const TableFileHeader& header, const void* data)
+{
+    TableFileHeader fileHeader = header;
+    fileHeader.magic = c_tableFileMagic;
+    fileHeader.version = c_tableFileVersion;
+    fileHeader.dataOffset = (sizeof(TableFileHeader) + c_tableFileDataAlignment - 1) / c_tableFileDataAlignment * c_tableFileDataAlignment;
+    fileHeader.dataSize = TableDataSize(fileHeader);
+
+    FILE* file = nullptr;
+    fopen_s(&file, fileName, "wb");
+    if (!file)
+        return false;
+
+    static const uint8 c_padding[c_tableFileDataAlignment] = {};
+    bool ret = fwrite(&fileHeader, sizeof(fileHeader), 1, file) == 1;
+    ret = ret && fwrite(c_padding, size_t(fileHeader.dataOffset) - sizeof(fileHeader), 1, file) == 1;
+    ret = ret && fwrite(data, size_t(fileHeader.dataSize), 1, file) == 1;
+    ret = (fclose(file) == 0) && ret;
+    return ret;
+}
+
+bool MappedTableFile::Open(const char* fileName)
+{
+    Close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    m_file = file;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < LONGLONG(sizeof(TableFileHeader)))
+    {
+        Close();
+        return false;
+    }
+
+    m_fileMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_fileMapping)
+    {
+        Close();
+        return false;
+    }
+
+    m_mappingSize = size_t(fileSize.QuadPart);
+    m_mapping = (const uint8*)MapViewOfFile(m_fileMapping, FILE_MAP_READ, 0, 0, 0);
+    if (!m_mapping)
+    {
+        Close();
+        return false;
+    }
+#else
+    int file = open(fileName, O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat fileStat;
+    if (fstat(file, &fileStat) != 0 || fileStat.st_size < off_t(sizeof(TableFileHeader)))
+    {
+        close(file);
+        return false;
+    }
+
+    // the mapping keeps its own reference to the file, so the descriptor isn't needed after this
+    void* mapping = mmap(nullptr, size_t(fileStat.st_size), PROT_READ, MAP_SHARED, file, 0);
+    close(file);
+    if (mapping == MAP_FAILED)
+        return false;
+
+    m_mapping = (const uint8*)mapping;
+    m_mappingSize = size_t(fileStat.st_size);
+#endif
+
+    const TableFileHeader* header = (const TableFileHeader*)m_mapping;
+    bool valid = header->magic == c_tableFileMagic
+        && header->version == c_tableFileVersion
+        && header->dataOffset % c_tableFileDataAlignment == 0
+        && header->dataOffset >= sizeof(TableFileHeader)
+        && header->dataSize == TableDataSize(*header)
+        && header->dataOffset + header->dataSize <= uint64_t(m_mappingSize);
+    if (!valid)
+    {
+        Close();
+        return false;
+    }
+
+    m_header = header;
+    return true;
+}
+
+void MappedTableFile::Close()
+{
+#ifdef _WIN32
+    if (m_mapping)
+        UnmapViewOfFile(m_mapping);
+    if (m_fileMapping)
+        CloseHandle(m_fileMapping);
+    if (m_file)
+        CloseHandle(m_file);
+    m_fileMapping = nullptr;
+    m_file = nullptr;
+#else
+    if (m_mapping)
+        munmap((void*)m_mapping, m_mappingSize);
+#endif
+    m_mapping = nullptr;
+    m_mappingSize = 0;
+    m_header = nullptr;
+}
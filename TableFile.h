@@ -0,0 +1,94 @@
+#pragma once
+
+#include "AAT.h"
+
+// Table files hold a table built once so that later runs and other processes can memory map it instead of rebuilding it.
+// The layout is a TableFileHeader, padded to c_tableFileDataAlignment bytes, followed by the table values in the
+// layout the header describes. Values are stored in the native byte order, which the magic number catches if it differs.
+
+enum class TableValueFormat : uint32
+{
+    UInt32,     // SATs and AATs
+    Int32,      // biased SATs
+    Half        // half float AATs
+};
+
+static const uint32 c_tableFileMagic = 0x54544141; // "AATT"
+static const uint32 c_tableFileVersion = 1;
+static const int c_tableFileDataAlignment = 64;
+
+struct TableFileHeader
+{
+    uint32 magic = c_tableFileMagic;
+    uint32 version = c_tableFileVersion;
+
+    // what the table is, and what to pass to the blur functions to read it
+    TableKind kind = TableKind::SAT;
+    DitherKind dither = DitherKind::Round;
+    TableValueFormat format = TableValueFormat::UInt32;
+    uint32 numBits = 32;    // bits of each value that are meaningful, eg the numBits a SAT blur masks to
+    int32 scale = 1;        // see TableVariant
+    int32 bias = 0;         // for biased SATs
+
+    uint32 width = 0;
+    uint32 height = 0;
+
+    // 1 for single channel tables, 4 for RGBA ones in channelLayout order
+    uint32 channels = 1;
+    ChannelLayout channelLayout = ChannelLayout::Interleaved;
+
+    // 0 means row major. The blurs only read row major tables, so these are recorded for tools that write tiled ones.
+    uint32 tileWidth = 0;
+    uint32 tileHeight = 0;
+
+    uint64_t dataOffset = 0;
+    uint64_t dataSize = 0;
+};
+
+// Bytes per value of a format
+size_t TableValueSize(TableValueFormat format);
+
+// Writes header and the table to fileName. dataOffset and dataSize are filled in from the table's size.
+bool WriteTableFile(const char* fileName, const TableFileHeader& header, const void* data);
+
+// A table file mapped into memory read only. The values are read in place by passing UInt32Values() etc to the
+// pointer versions of the blur functions, so nothing is copied and pages load as the blur touches them.
+class MappedTableFile
+{
+public:
+    MappedTableFile() = default;
+    ~MappedTableFile() { Close(); }
+
+    MappedTableFile(const MappedTableFile&) = delete;
+    MappedTableFile& operator=(const MappedTableFile&) = delete;
+
+    // Returns false if the file can't be mapped, or its header is bad or doesn't match the file size
+    bool Open(const char* fileName);
+    void Close();
+
+    bool IsOpen() const { return m_header != nullptr; }
+    const TableFileHeader& Header() const { return *m_header; }
+
+    // nullptr if the table isn't in that format
+    const uint32* UInt32Values() const { return Values<uint32>(TableValueFormat::UInt32); }
+    const int32* Int32Values() const { return Values<int32>(TableValueFormat::Int32); }
+    const uint16* HalfValues() const { return Values<uint16>(TableValueFormat::Half); }
+
+private:
+    template <typename T>
+    const T* Values(TableValueFormat format) const
+    {
+        if (!m_header || m_header->format != format)
+            return nullptr;
+        return (const T*)&m_mapping[m_header->dataOffset];
+    }
+
+    const uint8* m_mapping = nullptr;
+    size_t m_mappingSize = 0;
+    const TableFileHeader* m_header = nullptr;
+
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_fileMapping = nullptr;
+#endif
+};